@@ -0,0 +1,304 @@
+#ifndef PHILOSOPHERS_AFFINITY_HPP_
+#define PHILOSOPHERS_AFFINITY_HPP_
+
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace philosophers {
+
+/// @brief how threads are pinned to CPUs
+enum class Affinities
+{
+    /// threads are placed by OS scheduler
+    none,
+    /// neighbours around the table are pinned to the same or topologically closest CPUs
+    neighbours
+};
+
+inline char const*
+to_string(Affinities _affinity)
+{
+    switch (_affinity) {
+    case Affinities::none:
+        return "none";
+
+    case Affinities::neighbours:
+        return "neighbours";
+
+    default:
+        return "?????";
+    }
+}
+
+inline Affinities
+affinity_from_string(std::string const& _name)
+{
+    for (auto const affinity : {Affinities::none, Affinities::neighbours}) {
+        if (_name == to_string(affinity)) {
+            return affinity;
+        }
+    }
+
+    throw std::invalid_argument("Unknown affinity: " + _name);
+}
+
+/// @brief CPU available to the process with its position in the topology
+struct Cpu
+{
+    unsigned m_id;
+    unsigned m_node;
+    unsigned m_package;
+    unsigned m_core;
+
+    bool
+        operator<(Cpu const& _other)const
+    {
+        return this->m_node != _other.m_node ? this->m_node < _other.m_node
+               : this->m_package != _other.m_package ? this->m_package < _other.m_package
+               : this->m_core != _other.m_core ? this->m_core < _other.m_core
+               : this->m_id < _other.m_id;
+    }
+};
+
+/// @brief CPUs allowed for the process ordered by NUMA node, package and core from sysfs
+///
+/// Adjacent CPUs of the result share the closest cache level available.
+/// Missing sysfs entries are treated as 0, so unknown topology degrades to CPU id order.
+inline std::vector<Cpu>
+cpu_topology()
+{
+    struct Sysfs
+    {
+        static unsigned
+            read(std::string const& _path)
+        {
+            std::ifstream file(_path);
+            unsigned value = 0;
+            file >> value;
+            return value;
+        }
+
+        static unsigned
+            node(std::string const& _cpu_path)
+        {
+            unsigned result = 0;
+
+            if (DIR* const p_dir = opendir(_cpu_path.c_str())) {
+                while (dirent const* const p_entry = readdir(p_dir)) {
+                    if (0 == std::strncmp(p_entry->d_name, "node", 4)) {
+                        result = unsigned(std::strtoul(p_entry->d_name + 4, nullptr, 10));
+                        break;
+                    }
+                }
+
+                closedir(p_dir);
+            }
+
+            return result;
+        }
+    };
+
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+
+    if (0 != sched_getaffinity(0, sizeof(allowed), &allowed)) {
+        throw std::runtime_error("Failed to get process affinity");
+    }
+
+    std::vector<Cpu> result;
+
+    for (unsigned id = 0; id < CPU_SETSIZE; ++id) {
+        if (CPU_ISSET(id, &allowed)) {
+            std::string const path = "/sys/devices/system/cpu/cpu" + std::to_string(id);
+            Cpu cpu;
+            cpu.m_id = id;
+            cpu.m_node = Sysfs::node(path);
+            cpu.m_package = Sysfs::read(path + "/topology/physical_package_id");
+            cpu.m_core = Sysfs::read(path + "/topology/core_id");
+            result.push_back(cpu);
+        }
+    }
+
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+/// @brief pin calling thread to one CPU, affinity is a hint, so failure is reported but not thrown
+inline bool
+pin_current_thread(unsigned _cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(_cpu, &set);
+    return 0 == pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+/// @brief restore affinity of calling thread on scope exit
+class Thread_affinity_guard
+{
+public:
+    Thread_affinity_guard()
+        : m_is_saved(0 == pthread_getaffinity_np(pthread_self(), sizeof(m_saved), &m_saved))
+    {}
+
+    Thread_affinity_guard(Thread_affinity_guard const&) = delete;
+    Thread_affinity_guard& operator=(Thread_affinity_guard const&) = delete;
+
+    ~Thread_affinity_guard()
+    {
+        if (this->m_is_saved) {
+            pthread_setaffinity_np(pthread_self(), sizeof(m_saved), &m_saved);
+        }
+    }
+
+private:
+    cpu_set_t m_saved;
+    bool const m_is_saved;
+};
+
+/// @brief CPUs of seats and pool workers
+///
+/// Slots (seats or workers) are laid over CPUs in topology order: while there are enough CPUs
+/// every slot gets its own one, otherwise consecutive slots share CPUs in equal blocks.
+/// So neighbours around the table, and the forks between them, stay on the same core or cache domain.
+/// Tables of a Banquet are laid out one after another, and pool workers are spread over CPUs of their table.
+class Affinity_map
+{
+public:
+    /// @param _first_seat banquet-wide number of the first seat of the table
+    /// @param _banquet_size number of seats at all tables, 0 - single table
+    Affinity_map(Affinities _affinity, unsigned _first_seat, unsigned _number_of_seats, unsigned _banquet_size, unsigned _number_of_workers)
+        : m_affinity(_affinity)
+        , m_first_seat(_first_seat)
+    {
+        if (Affinities::none == _affinity) {
+            return;
+        }
+
+        this->m_cpus = cpu_topology();
+        unsigned const banquet_size = std::max(_banquet_size, _first_seat + _number_of_seats);
+
+        for (unsigned i = 0; i < _number_of_seats; ++i) {
+            this->m_seats.push_back(slot_cpu(_first_seat + i, banquet_size));
+        }
+
+        for (unsigned i = 0; i < _number_of_workers && _number_of_seats; ++i) {
+            this->m_workers.push_back(this->m_seats[std::size_t(i) * _number_of_seats / _number_of_workers]);
+        }
+    }
+
+    Affinities
+        affinity()const
+    {
+        return this->m_affinity;
+    }
+
+    bool
+        is_pinned()const
+    {
+        return Affinities::none != this->m_affinity && !this->m_cpus.empty();
+    }
+
+    /// @brief pin calling thread to CPU of seat
+    bool
+        pin_seat(unsigned _seat)const
+    {
+        return this->is_pinned() && pin_current_thread(this->m_cpus[this->m_seats[_seat]].m_id);
+    }
+
+    /// @brief pin calling thread to CPU of pool worker
+    bool
+        pin_worker(unsigned _worker)const
+    {
+        return this->is_pinned() && pin_current_thread(this->m_cpus[this->m_workers[_worker]].m_id);
+    }
+
+    /// @brief print CPUs with their node, core and ranges of seats and workers
+    void
+        print(std::ostream& _out)const
+    {
+        _out << "Affinity " << to_string(this->m_affinity);
+
+        if (!this->is_pinned()) {
+            _out << std::endl;
+            return;
+        }
+
+        _out << ":" << std::endl;
+
+        for (unsigned i = 0; i < this->m_cpus.size(); ++i) {
+            std::string const seats = ranges(this->m_seats, i, this->m_first_seat);
+            std::string const workers = ranges(this->m_workers, i, 0);
+
+            if (seats.empty() && workers.empty()) {
+                continue;
+            }
+
+            Cpu const& cpu = this->m_cpus[i];
+            _out << "  cpu " << cpu.m_id << " (node " << cpu.m_node << ", package " << cpu.m_package << ", core " << cpu.m_core << ")";
+
+            if (!seats.empty()) {
+                _out << " seats " << seats;
+            }
+
+            if (!workers.empty()) {
+                _out << " workers " << workers;
+            }
+
+            _out << std::endl;
+        }
+    }
+
+private:
+    unsigned
+        slot_cpu(unsigned _slot, unsigned _number_of_slots)const
+    {
+        std::size_t const number_of_cpus = this->m_cpus.size();
+        return unsigned(_number_of_slots <= number_of_cpus ? _slot : std::size_t(_slot) * number_of_cpus / _number_of_slots);
+    }
+
+    /// @brief comma separated ranges of slots mapped to CPU
+    static std::string
+        ranges(std::vector<unsigned> const& _slots, unsigned _cpu, unsigned _offset)
+    {
+        std::string result;
+
+        for (unsigned first = 0; first < _slots.size(); ++first) {
+            if (_slots[first] != _cpu) {
+                continue;
+            }
+
+            unsigned last = first;
+
+            while (last + 1 < _slots.size() && _slots[last + 1] == _cpu) {
+                ++last;
+            }
+
+            result += (result.empty() ? "" : ",") + std::to_string(_offset + first) + (last != first ? "-" + std::to_string(_offset + last) : "");
+            first = last;
+        }
+
+        return result;
+    }
+
+    Affinities const m_affinity;
+    unsigned const m_first_seat;
+    std::vector<Cpu> m_cpus;
+    /// index in m_cpus of every seat and worker
+    std::vector<unsigned> m_seats;
+    std::vector<unsigned> m_workers;
+};
+
+}  // namespace philosophers
+
+#endif  // PHILOSOPHERS_AFFINITY_HPP_
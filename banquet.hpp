@@ -0,0 +1,352 @@
+#ifndef PHILOSOPHERS_BANQUET_HPP_
+#define PHILOSOPHERS_BANQUET_HPP_
+
+#include "canteen.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace philosophers {
+
+/// @brief monitor of one Banquet table, forwards batches of its events with banquet-wide seat ids
+///
+/// Philosophers of the table contend only for the queue of their shard,
+/// aggregated monitor receives whole batches under one mutex shared by all shards.
+class Shard_monitor
+    : public Monitor
+{
+public:
+    Shard_monitor(Monitor& _aggregate, std::mutex& _aggregate_mutex, unsigned _first_seat, Log_queue_config const& _log_queue)
+        : Monitor(_log_queue)
+        , m_aggregate(_aggregate)
+        , m_aggregate_mutex(_aggregate_mutex)
+        , m_first_seat(_first_seat)
+        , m_meals(0)
+    {}
+
+    /// @brief meals at the table, read after the table is stopped
+    std::uint64_t
+        meals()const
+    {
+        return this->m_meals;
+    }
+
+protected:
+    void
+        events_logger(log_queue_type const& work_log)override
+    {
+        this->m_batch.assign(work_log.cbegin(), work_log.cend());
+
+        for (auto& el : this->m_batch) {
+            if (Philosopher::States::dines == el.m_state) {
+                ++this->m_meals;
+            }
+
+            el.m_id += this->m_first_seat;
+        }
+
+        std::lock_guard<std::mutex> lock(this->m_aggregate_mutex);
+        this->m_aggregate.consume(this->m_batch);
+    }
+
+private:
+    Monitor& m_aggregate;
+    std::mutex& m_aggregate_mutex;
+    unsigned const m_first_seat;
+    std::uint64_t m_meals;
+    log_queue_type m_batch;
+};
+
+/// @brief banquet configuration
+struct Banquet_config
+{
+    Banquet_config()
+        : m_number_of_tables(1)
+        , m_transfer_interval(0)
+    {}
+
+    /// configuration of every table, m_number_of_philosophers is the number of guests at all tables
+    Canteen_config m_canteen;
+    unsigned m_number_of_tables;
+    /// guests are moved between tables every interval, 0 - no transfers
+    std::chrono::seconds m_transfer_interval;
+    /// queue of every table shard
+    Log_queue_config m_log_queue;
+};
+
+/// @brief independent Canteen tables run at once, each with own forks, threads and monitor shard
+///
+/// Seats are numbered banquet-wide table after table, events of all tables feed one aggregated monitor.
+/// With guest transfer tables are re-seated every transfer interval: one guest moves
+/// from the table with the fewest meals per seat to the table with the most.
+/// No guest moves live, every transfer stops all tables and rebuilds their canteens and threads
+/// with the new sizes, so all philosophers start over with thinking (see restart_time()).
+class Banquet
+{
+public:
+    Banquet(Monitor& _monitor, Banquet_config const& _config)
+        : m_config(_config)
+        , m_p_monitor(&_monitor)
+        , m_transfers(0)
+        , m_restarts(0)
+        , m_restart_time(0)
+    {
+        unsigned const number_of_guests = _config.m_canteen.m_number_of_philosophers;
+
+        if (0 == _config.m_number_of_tables || number_of_guests < 2 * _config.m_number_of_tables) {
+            throw std::invalid_argument("Invalid number of tables (<1 or less than 2 guests per table)");
+        }
+
+        for (unsigned i = 0; i < _config.m_number_of_tables; ++i) {
+            this->m_table_sizes.push_back(number_of_guests * (i + 1) / _config.m_number_of_tables - number_of_guests * i / _config.m_number_of_tables);
+        }
+    }
+
+    /// @brief run until the first table fails, simulation returns when all tables finish
+    ///
+    /// With guest transfer rounds are repeated for simulated duration in simulation mode, otherwise forever.
+    void
+        operator()()
+    {
+        if (is_transferring()) {
+            std::chrono::seconds const duration = this->m_config.m_canteen.m_duration;
+            run_rounds(Execution_modes::simulation == this->m_config.m_canteen.m_execution_mode && duration.count() > 0
+                       ? duration
+                       : std::chrono::seconds::max());
+        } else {
+            seat();
+            run_round(this->m_config.m_canteen.m_duration, false);
+            clear();
+        }
+
+        // tables finish only their shards
+        this->m_p_monitor->finish();
+    }
+
+    /// @brief run for _duration (simulated time in simulation mode) and return normally
+    void
+        run_for(std::chrono::seconds _duration)
+    {
+        if (is_transferring()) {
+            run_rounds(_duration);
+        } else {
+            seat();
+            run_round(_duration, true);
+            clear();
+        }
+
+        this->m_p_monitor->finish();
+    }
+
+    std::vector<unsigned> const&
+        table_sizes()const
+    {
+        return this->m_table_sizes;
+    }
+
+    /// @brief number of guests moved between tables
+    unsigned
+        transfers()const
+    {
+        return this->m_transfers;
+    }
+
+    /// @brief number of times all tables were torn down and rebuilt between rounds
+    unsigned
+        restarts()const
+    {
+        return this->m_restarts;
+    }
+
+    /// @brief wall time between the end of a round and the start of the next one, spent rebuilding all tables
+    steady_clock::duration
+        restart_time()const
+    {
+        return this->m_restart_time;
+    }
+
+    /// @brief counters of finished rounds, aggregated when tables are cleared
+    Counters_snapshot const&
+        counters_snapshot()const
+    {
+        return this->m_counters;
+    }
+
+    /// @brief affinity maps of all tables
+    void
+        print_affinity(std::ostream& _out)
+    {
+        seat();
+
+        for (unsigned i = 0; i < this->m_tables.size(); ++i) {
+            _out << "Table " << i << " ";
+            this->m_tables[i].m_p_canteen->affinity_map().print(_out);
+        }
+    }
+
+private:
+    struct Table
+    {
+        std::unique_ptr<Shard_monitor> m_p_monitor;
+        std::unique_ptr<Canteen> m_p_canteen;
+    };
+
+    bool
+        is_transferring()const
+    {
+        return this->m_config.m_transfer_interval.count() > 0 && this->m_table_sizes.size() > 1;
+    }
+
+    /// @brief timed rounds of transfer interval, guests are re-seated between rounds
+    void
+        run_rounds(std::chrono::seconds _duration)
+    {
+        steady_clock::time_point round_end;
+
+        for (std::chrono::seconds elapsed(0); elapsed < _duration; elapsed += this->m_config.m_transfer_interval) {
+            seat();
+
+            if (elapsed.count() > 0) {
+                ++this->m_restarts;
+                this->m_restart_time += steady_clock::now() - round_end;
+            }
+
+            run_round(std::min(this->m_config.m_transfer_interval, _duration - elapsed), true);
+            round_end = steady_clock::now();
+            std::vector<double> meals_per_seat;
+
+            for (unsigned i = 0; i < this->m_tables.size(); ++i) {
+                meals_per_seat.push_back(double(this->m_tables[i].m_p_monitor->meals()) / this->m_table_sizes[i]);
+            }
+
+            clear();
+            transfer(meals_per_seat);
+        }
+    }
+
+    /// @brief create tables for current table sizes, seats are numbered banquet-wide
+    void
+        seat()
+    {
+        if (!this->m_tables.empty()) {
+            return;
+        }
+
+        Seating seating;
+        seating.m_fork_policy = this->m_config.m_canteen.m_fork_policy;
+        unsigned first_seat = 0;
+
+        for (unsigned const size : this->m_table_sizes) {
+            Canteen_config config = this->m_config.m_canteen;
+            config.m_number_of_philosophers = size;
+            config.m_first_seat = first_seat;
+            config.m_banquet_size = this->m_config.m_canteen.m_number_of_philosophers;
+            Table table;
+            table.m_p_monitor.reset(new Shard_monitor(*this->m_p_monitor, this->m_aggregate_mutex, first_seat, this->m_config.m_log_queue));
+            table.m_p_canteen.reset(new Canteen(*table.m_p_monitor, config));
+            this->m_tables.push_back(std::move(table));
+
+            for (unsigned i = 0; i < size; ++i) {
+                seating.m_forks.emplace_back(first_seat + i, first_seat + (i + 1) % size);
+            }
+
+            first_seat += size;
+        }
+
+        this->m_p_monitor->set_seating(seating);
+    }
+
+    /// @brief every table runs on its own thread, the first failure is rethrown after all tables stop
+    void
+        run_round(std::chrono::seconds _duration, bool _is_timed)
+    {
+        std::exception_ptr p_failure;
+        std::mutex failure_mutex;
+        std::vector<std::thread> threads;
+
+        for (Table& table : this->m_tables) {
+            threads.emplace_back([&table, &p_failure, &failure_mutex, _duration, _is_timed, this]() {
+                try {
+                    if (_is_timed) {
+                        table.m_p_canteen->run_for(_duration);
+                    } else {
+                        (*table.m_p_canteen)();
+                    }
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(failure_mutex);
+
+                    if (!p_failure) {
+                        p_failure = std::current_exception();
+                    }
+
+                    // the banquet fails as a whole
+                    for (Table& other : this->m_tables) {
+                        other.m_p_monitor->request_stop();
+                    }
+                }
+            });
+        }
+
+        for (auto& thr : threads) {
+            thr.join();
+        }
+
+        if (p_failure) {
+            clear();
+            std::rethrow_exception(p_failure);
+        }
+    }
+
+    void
+        clear()
+    {
+        for (Table& table : this->m_tables) {
+            Counters_snapshot const counters = table.m_p_monitor->counters_snapshot();
+
+            for (std::size_t i = 0; i < number_of_counters; ++i) {
+                this->m_counters.m_values[i] += counters.m_values[i];
+            }
+        }
+
+        this->m_tables.clear();
+    }
+
+    /// @brief move one guest from the most contended table to the least one, ignoring differences below 10%
+    void
+        transfer(std::vector<double> const& _meals_per_seat)
+    {
+        auto const minmax = std::minmax_element(_meals_per_seat.cbegin(), _meals_per_seat.cend());
+        unsigned const from = unsigned(minmax.first - _meals_per_seat.cbegin());
+        unsigned const to = unsigned(minmax.second - _meals_per_seat.cbegin());
+
+        if (*minmax.second <= *minmax.first * 1.1 || this->m_table_sizes[from] <= 2) {
+            return;
+        }
+
+        --this->m_table_sizes[from];
+        ++this->m_table_sizes[to];
+        ++this->m_transfers;
+    }
+
+    Banquet_config const m_config;
+    Monitor* const m_p_monitor;
+    std::mutex m_aggregate_mutex;
+    std::vector<unsigned> m_table_sizes;
+    std::vector<Table> m_tables;
+    unsigned m_transfers;
+    unsigned m_restarts;
+    steady_clock::duration m_restart_time;
+    Counters_snapshot m_counters;
+};
+
+}  // namespace philosophers
+
+#endif  // PHILOSOPHERS_BANQUET_HPP_
@@ -0,0 +1,1391 @@
+#ifndef PHILOSOPHERS_CANTEEN_HPP_
+#define PHILOSOPHERS_CANTEEN_HPP_
+
+#include "affinity.hpp"
+#include "fork_policy.hpp"
+#include "monitor.hpp"
+#include "topology.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <numeric>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace philosophers {
+
+/// @brief fixed capacity contiguous array of non-movable objects, every element starts a new cache line
+template<typename Element>
+class Cache_aligned_array
+{
+    static_assert(alignof(Element) <= cache_line_size, "Element is over-aligned");
+
+public:
+    static std::size_t const stride = (sizeof(Element) + cache_line_size - 1) / cache_line_size * cache_line_size;
+
+    explicit
+        Cache_aligned_array(std::size_t _capacity)
+        : m_storage(new char[_capacity * stride + cache_line_size])
+        , m_p_begin(nullptr)
+        , m_size(0)
+        , m_capacity(_capacity)
+    {
+        void* p_begin = this->m_storage.get();
+        std::size_t space = _capacity * stride + cache_line_size;
+        this->m_p_begin = static_cast<char*>(std::align(cache_line_size, _capacity * stride, p_begin, space));
+    }
+
+    Cache_aligned_array(Cache_aligned_array const&) = delete;
+    Cache_aligned_array& operator=(Cache_aligned_array const&) = delete;
+
+    ~Cache_aligned_array()
+    {
+        while (this->m_size) {
+            (*this)[--this->m_size].~Element();
+        }
+    }
+
+    template<typename... Arguments>
+    Element&
+        emplace_back(Arguments&& ... _arguments)
+    {
+        if (this->m_size == this->m_capacity) {
+            throw std::length_error("Cache_aligned_array is full");
+        }
+
+        Element* const p_element = new(this->m_p_begin + this->m_size * stride) Element(std::forward<Arguments>(_arguments)...);
+        ++this->m_size;
+        return *p_element;
+    }
+
+    Element&
+        operator[](std::size_t _index)
+    {
+        return *reinterpret_cast<Element*>(this->m_p_begin + _index * stride);
+    }
+
+    std::size_t
+        size()const
+    {
+        return this->m_size;
+    }
+
+private:
+    std::unique_ptr<char[]> m_storage;
+    char* m_p_begin;
+    std::size_t m_size;
+    std::size_t const m_capacity;
+};
+
+/// @brief philosophers sharing at least one fork with each philosopher
+///
+/// Users of every fork are grouped by counting sort into flat arrays, so the cost is linear in seat-fork edges.
+template<typename Philosopher_type>
+std::vector<std::vector<unsigned>>
+fork_neighbours(std::vector<Philosopher_type*> const& _philosophers)
+{
+    struct Edge
+    {
+        unsigned m_fork;
+        unsigned m_seat;
+    };
+
+    std::vector<Edge> edges;
+    unsigned number_of_forks = 0;
+
+    for (unsigned i = 0; i < _philosophers.size(); ++i) {
+        Philosopher const& philosopher = *_philosophers[i];
+
+        if (philosopher.has_fork_set()) {
+            for (Fork* const p_fork : philosopher.forks()) {
+                edges.push_back(Edge{p_fork->id(), i});
+            }
+        } else {
+            edges.push_back(Edge{philosopher.left_fork().id(), i});
+            edges.push_back(Edge{philosopher.right_fork().id(), i});
+        }
+    }
+
+    for (Edge const& edge : edges) {
+        number_of_forks = std::max(number_of_forks, edge.m_fork + 1);
+    }
+
+    std::vector<std::size_t> offsets(number_of_forks + 1, 0);
+
+    for (Edge const& edge : edges) {
+        ++offsets[edge.m_fork + 1];
+    }
+
+    std::partial_sum(offsets.cbegin(), offsets.cend(), offsets.begin());
+    std::vector<unsigned> users(edges.size());
+    std::vector<std::size_t> next(offsets.cbegin(), offsets.cend() - 1);
+
+    for (Edge const& edge : edges) {
+        users[next[edge.m_fork]++] = edge.m_seat;
+    }
+
+    std::vector<std::vector<unsigned>> result(_philosophers.size());
+
+    for (unsigned fork = number_of_forks; fork-- > 0;) {
+        for (std::size_t i = offsets[fork]; i < offsets[fork + 1]; ++i) {
+            for (std::size_t j = offsets[fork]; j < offsets[fork + 1]; ++j) {
+                if (users[j] != users[i]) {
+                    result[users[i]].push_back(users[j]);
+                }
+            }
+        }
+    }
+
+    // neighbours sharing several forks are listed once
+    std::vector<unsigned> listed_by(_philosophers.size(), ~0u);
+
+    for (unsigned user = 0; user < result.size(); ++user) {
+        std::vector<unsigned>& neighbours = result[user];
+        neighbours.erase(std::remove_if(neighbours.begin(), neighbours.end(), [&listed_by, user](unsigned _neighbour) {
+            bool const is_listed = listed_by[_neighbour] == user;
+            listed_by[_neighbour] = user;
+            return is_listed;
+        }), neighbours.end());
+    }
+
+    return result;
+}
+
+/// @brief cooperative scheduler multiplexing philosophers over fixed number of worker threads
+///
+/// Every philosopher is a resumable task driven by Philosopher::step().
+/// Thinking and eating are timers; philosopher waiting for forks is parked (does not occupy a worker)
+/// and is resumed when a neighbour sharing one of its forks releases them, or at its starvation deadline.
+template<typename Philosopher_type>
+class Scheduler
+{
+    typedef steady_clock::time_point time_point;
+
+    struct Timer
+    {
+        time_point m_time;
+        unsigned m_seat;
+        /// resume parked philosopher for starvation check
+        bool m_is_deadline;
+
+        bool
+            operator>(Timer const& _other)const
+        {
+            return this->m_time > _other.m_time;
+        }
+    };
+
+    struct Seat
+    {
+        Seat()
+            : m_is_parked(false)
+        {}
+
+        std::mutex m_park_mutex;
+        bool m_is_parked;
+        /// philosophers sharing forks with this seat
+        std::vector<unsigned> m_neighbours;
+    };
+
+public:
+    Scheduler(std::vector<Philosopher_type*> const& _philosophers, unsigned _number_of_workers, Affinity_map const& _affinity_map)
+        : m_philosophers(_philosophers)
+        , m_seats(_philosophers.size())
+        , m_number_of_workers(std::max(1u, _number_of_workers))
+        , m_affinity_map(_affinity_map)
+        , m_is_stopped(false)
+    {
+        std::vector<std::vector<unsigned>> neighbours = fork_neighbours(_philosophers);
+
+        for (unsigned i = 0; i < this->m_seats.size(); ++i) {
+            this->m_seats[i].m_neighbours.swap(neighbours[i]);
+        }
+    }
+
+    ~Scheduler()
+    {
+        stop();
+    }
+
+    void
+        start()
+    {
+        for (unsigned i = 0; i < this->m_philosophers.size(); ++i) {
+            add_timer(i, this->m_philosophers[i]->start().m_interval, false);
+        }
+
+        this->m_workers.reserve(this->m_number_of_workers);
+
+        for (unsigned i = 0; i < this->m_number_of_workers; ++i) {
+            this->m_workers.emplace_back(&Scheduler::worker, this, i);
+        }
+    }
+
+    void
+        stop()
+    {
+        // not under the mutex: busy workers re-take it at once and could keep the stopper out
+        this->m_is_stopped.store(true);
+        {
+            std::lock_guard<decltype(m_mutex)> lock(m_mutex);
+        }
+        this->m_event.notify_all();
+
+        for (auto& thr : this->m_workers) {
+            thr.join();
+        }
+
+        this->m_workers.clear();
+    }
+
+private:
+    void
+        worker(unsigned _worker)
+    {
+        this->m_affinity_map.pin_worker(_worker);
+        std::unique_lock<decltype(m_mutex)> lock(m_mutex);
+
+        while (!this->m_is_stopped.load(std::memory_order_relaxed)) {
+            if (!this->m_ready.empty()) {
+                unsigned const seat = this->m_ready.front();
+                this->m_ready.pop_front();
+                lock.unlock();
+                resume(seat);
+                lock.lock();
+            } else if (this->m_timers.empty()) {
+                this->m_event.wait(lock);
+            } else if (steady_clock::now() < this->m_timers.top().m_time) {
+                this->m_event.wait_until(lock, this->m_timers.top().m_time);
+            } else {
+                Timer const timer = this->m_timers.top();
+                this->m_timers.pop();
+                lock.unlock();
+
+                if (!timer.m_is_deadline || unpark(timer.m_seat)) {
+                    resume(timer.m_seat);
+                }
+
+                lock.lock();
+            }
+        }
+    }
+
+    void
+        resume(unsigned _seat)
+    {
+        Philosopher_type& philosopher = *this->m_philosophers[_seat];
+        Philosopher::Step step = philosopher.step();
+
+        if (Philosopher::Step::park == step.m_kind) {
+            Seat& seat = this->m_seats[_seat];
+            std::lock_guard<std::mutex> lock(seat.m_park_mutex);
+            // retry under park mutex: neighbour releasing forks after this point will find the seat parked
+            step = philosopher.step();
+
+            if (Philosopher::Step::park == step.m_kind) {
+                seat.m_is_parked = true;
+
+                if (step.m_interval != std::chrono::nanoseconds::max()) {
+                    add_timer(_seat, step.m_interval, true);
+                }
+
+                return;
+            }
+        }
+
+        if (Philosopher::Step::finished == step.m_kind) {
+            return;
+        }
+
+        if (step.m_is_forks_released) {
+            for (unsigned const neighbour : this->m_seats[_seat].m_neighbours) {
+                if (unpark(neighbour)) {
+                    {
+                        std::lock_guard<decltype(m_mutex)> lock(m_mutex);
+                        this->m_ready.push_back(neighbour);
+                    }
+                    this->m_event.notify_one();
+                }
+            }
+        }
+
+        // spin work occupies the worker like a thread, the philosopher is resumed at once
+        if (g_is_spin_work && philosopher.spin_for(step.m_interval)) {
+            step.m_interval = std::chrono::nanoseconds(0);
+        }
+
+        add_timer(_seat, step.m_interval, false);
+    }
+
+    /// @return true if seat was parked, caller is responsible to resume it
+    bool
+        unpark(unsigned _seat)
+    {
+        Seat& seat = this->m_seats[_seat];
+        std::lock_guard<std::mutex> lock(seat.m_park_mutex);
+        bool const is_parked = seat.m_is_parked;
+        seat.m_is_parked = false;
+        return is_parked;
+    }
+
+    void
+        add_timer(unsigned _seat, std::chrono::nanoseconds _interval, bool _is_deadline)
+    {
+        Timer const timer = {steady_clock::now() + _interval, _seat, _is_deadline};
+        {
+            std::lock_guard<decltype(m_mutex)> lock(m_mutex);
+            this->m_timers.push(timer);
+        }
+        this->m_event.notify_one();
+    }
+
+    std::vector<Philosopher_type*> const& m_philosophers;
+    std::vector<Seat> m_seats;
+    unsigned const m_number_of_workers;
+    Affinity_map const& m_affinity_map;
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_mutex;
+    std::condition_variable m_event;
+    std::atomic<bool> m_is_stopped;
+    std::deque<unsigned> m_ready;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> m_timers;
+};
+
+/// @brief discrete-event simulation of philosophers on virtual time
+///
+/// Philosophers are driven by Philosopher::step() with the same fork policies as in Scheduler,
+/// but single-threaded: instead of waiting for intervals the virtual clock jumps to the next event.
+/// Monitor is drained after all events of the same virtual time are processed.
+template<typename Philosopher_type>
+class Simulation
+{
+    typedef Clock::time_point time_point;
+
+    struct Event
+    {
+        time_point m_time;
+        /// order of events scheduled for the same time
+        std::uint64_t m_sequence;
+        unsigned m_seat;
+        /// resume parked philosopher for starvation check
+        bool m_is_deadline;
+
+        bool
+            operator>(Event const& _other)const
+        {
+            return this->m_time != _other.m_time ? this->m_time > _other.m_time : this->m_sequence > _other.m_sequence;
+        }
+    };
+
+public:
+    Simulation(std::vector<Philosopher_type*> const& _philosophers, Virtual_clock& _clock, Monitor& _monitor)
+        : m_philosophers(_philosophers)
+        , m_neighbours(fork_neighbours(_philosophers))
+        , m_is_parked(_philosophers.size(), false)
+        , m_clock(_clock)
+        , m_monitor(_monitor)
+        , m_sequence(0)
+        , m_check_interval(0)
+    {
+        this->m_monitor.set_drained_inline(true);
+    }
+
+    ~Simulation()
+    {
+        this->m_monitor.set_drained_inline(false);
+    }
+
+    /// @brief simulation ends when _is_done returns true, it is checked every _interval of virtual time
+    void
+        set_stop_condition(std::function<bool()> const& _is_done, Clock::time_point::duration _interval)
+    {
+        this->m_is_done = _is_done;
+        this->m_check_interval = _interval;
+    }
+
+    /// @brief simulate _duration of virtual time, zero duration - until all philosophers are dead
+    void
+        run(Clock::time_point::duration _duration)
+    {
+        for (unsigned i = 0; i < this->m_philosophers.size(); ++i) {
+            schedule(i, this->m_philosophers[i]->start().m_interval, false);
+        }
+
+        this->m_monitor.drain();
+        time_point const end = _duration == Clock::time_point::duration::zero()
+                               ? time_point::max()
+                               : this->m_clock.now() + _duration;
+        time_point next_check = this->m_clock.now() + this->m_check_interval;
+
+        while (!this->m_events.empty() && this->m_events.top().m_time <= end) {
+            time_point const time = this->m_events.top().m_time;
+
+            if (this->m_is_done && next_check <= time) {
+                if (this->m_is_done()) {
+                    return;
+                }
+
+                next_check = time + this->m_check_interval;
+            }
+
+            this->m_clock.advance_to(time);
+
+            while (!this->m_events.empty() && this->m_events.top().m_time == time) {
+                Event const event = this->m_events.top();
+                this->m_events.pop();
+
+                if (this->m_is_parked[event.m_seat] || !event.m_is_deadline) {
+                    this->m_is_parked[event.m_seat] = false;
+                    resume(event.m_seat);
+                }
+            }
+
+            this->m_monitor.drain();
+        }
+    }
+
+private:
+    void
+        resume(unsigned _seat)
+    {
+        Philosopher::Step const step = this->m_philosophers[_seat]->step();
+
+        switch (step.m_kind) {
+        case Philosopher::Step::park:
+            this->m_is_parked[_seat] = true;
+
+            if (step.m_interval != std::chrono::nanoseconds::max()) {
+                schedule(_seat, step.m_interval, true);
+            }
+
+            break;
+
+        case Philosopher::Step::sleep:
+            if (step.m_is_forks_released) {
+                for (unsigned const neighbour : this->m_neighbours[_seat]) {
+                    if (this->m_is_parked[neighbour]) {
+                        this->m_is_parked[neighbour] = false;
+                        schedule(neighbour, std::chrono::nanoseconds(0), false);
+                    }
+                }
+            }
+
+            schedule(_seat, step.m_interval, false);
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    void
+        schedule(unsigned _seat, std::chrono::nanoseconds _interval, bool _is_deadline)
+    {
+        Event const event = {this->m_clock.now() + _interval, this->m_sequence++, _seat, _is_deadline};
+        this->m_events.push(event);
+    }
+
+    std::vector<Philosopher_type*> const& m_philosophers;
+    std::vector<std::vector<unsigned>> const m_neighbours;
+    std::vector<bool> m_is_parked;
+    Virtual_clock& m_clock;
+    Monitor& m_monitor;
+    std::uint64_t m_sequence;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> m_events;
+    std::function<bool()> m_is_done;
+    Clock::time_point::duration m_check_interval;
+};
+
+enum class Execution_modes
+{
+    /// one std::thread per philosopher
+    threads,
+    /// philosophers are multiplexed over Scheduler workers
+    pool,
+    /// single-threaded discrete-event Simulation on virtual time
+    simulation
+};
+
+inline char const*
+to_string(Execution_modes _mode)
+{
+    switch (_mode) {
+    case Execution_modes::threads:
+        return "threads";
+
+    case Execution_modes::pool:
+        return "pool";
+
+    case Execution_modes::simulation:
+        return "simulation";
+
+    default:
+        return "?????";
+    }
+}
+
+inline Execution_modes
+execution_mode_from_string(std::string const& _name)
+{
+    for (auto const mode : {Execution_modes::threads, Execution_modes::pool, Execution_modes::simulation}) {
+        if (_name == to_string(mode)) {
+            return mode;
+        }
+    }
+
+    throw std::invalid_argument("Unknown execution mode: " + _name);
+}
+
+/// @brief how forks and philosophers are placed in memory
+enum class Layouts
+{
+    /// every fork and philosopher is a separate heap allocation
+    scattered,
+    /// forks and philosophers in contiguous arrays, each object starts its own cache line
+    contiguous
+};
+
+inline char const*
+to_string(Layouts _layout)
+{
+    switch (_layout) {
+    case Layouts::scattered:
+        return "scattered";
+
+    case Layouts::contiguous:
+        return "contiguous";
+
+    default:
+        return "?????";
+    }
+}
+
+inline Layouts
+layout_from_string(std::string const& _name)
+{
+    for (auto const layout : {Layouts::scattered, Layouts::contiguous}) {
+        if (_name == to_string(layout)) {
+            return layout;
+        }
+    }
+
+    throw std::invalid_argument("Unknown layout: " + _name);
+}
+
+/// @brief canteen configuration
+struct Canteen_config
+{
+    Canteen_config()
+        : m_number_of_philosophers(64)
+        , m_fork_policy(Fork_policies::back_off)
+        , m_execution_mode(Execution_modes::threads)
+        , m_number_of_workers(0)
+        , m_duration(0)
+        , m_layout(Layouts::scattered)
+        , m_affinity(Affinities::none)
+        , m_first_seat(0)
+        , m_banquet_size(0)
+#ifdef PHILOSOPHERS_STARVATION
+        , m_is_starvation_enabled(true)
+#else
+        , m_is_starvation_enabled(false)
+#endif
+        , m_is_monitored(true)
+        , m_seat_capacity(0)
+        , m_meals_per_philosopher(0)
+        , m_total_meals(0)
+    {}
+
+    unsigned m_number_of_philosophers;
+    Fork_policies m_fork_policy;
+    Execution_modes m_execution_mode;
+    /// number of Scheduler workers in pool mode, 0 - hardware concurrency
+    unsigned m_number_of_workers;
+    /// simulated time of operator() in simulation mode, 0 - unlimited
+    std::chrono::seconds m_duration;
+    Layouts m_layout;
+    /// pinning of philosopher threads or pool workers, ignored in simulation mode
+    Affinities m_affinity;
+    /// banquet-wide number of the first seat, seeds random generators of philosophers and places them on CPUs
+    unsigned m_first_seat;
+    /// number of seats at all tables of a Banquet, 0 - single table
+    unsigned m_banquet_size;
+    /// philosophers die if they can not get forks for a long time, default is PHILOSOPHERS_STARVATION
+    bool m_is_starvation_enabled;
+    /// state changes are reported to monitor, otherwise monitor is used only to stop the canteen
+    bool m_is_monitored;
+    /// recorded schedule replayed in simulation mode, copied by every canteen, nullptr - random intervals
+    std::shared_ptr<Schedule_script const> m_p_script;
+    /// distributions of random intervals, hot seats are banquet-wide
+    Workload m_workload;
+    /// fork sets of seats, m_number_of_philosophers should match its seats, nullptr - ring
+    std::shared_ptr<Topology const> m_p_topology;
+    /// seats ever created including ones added by Canteen::add_seat(), 0 - m_number_of_philosophers
+    unsigned m_seat_capacity;
+    /// run stops when every seated philosopher had that many meals, 0 - no quota, needs PHILOSOPHERS_COUNTERS
+    std::uint64_t m_meals_per_philosopher;
+    /// run stops when all seats had that many meals together, 0 - no quota, needs PHILOSOPHERS_COUNTERS
+    std::uint64_t m_total_meals;
+
+    bool
+        has_meal_quota()const
+    {
+        return 0 != this->m_meals_per_philosopher || 0 != this->m_total_meals;
+    }
+};
+
+/// @brief canteen independent of its compile-time specialization
+class Canteen_interface
+{
+public:
+    virtual
+        ~Canteen_interface()
+    {}
+
+    virtual void
+        operator()() = 0;
+
+    virtual void
+        run_for(std::chrono::seconds _duration) = 0;
+
+    virtual Clock::time_point::duration
+        run_time()const = 0;
+
+    virtual Affinity_map const&
+        affinity_map()const = 0;
+
+    virtual unsigned
+        add_seat(unsigned _after_seat) = 0;
+
+    virtual void
+        remove_seat(unsigned _seat) = 0;
+
+    virtual std::vector<unsigned>
+        seats()const = 0;
+};
+
+/// @brief canteen with philosophers specialized for fork policy, starvation and events sink
+///
+/// Only construction and run are virtual, hot loops of philosophers, Scheduler and Simulation are not.
+template<typename Policy, typename Starvation_policy, typename Sink>
+class Basic_canteen
+    : public Canteen_interface
+{
+public:
+    typedef Basic_philosopher<Policy, Starvation_policy, Sink> philosopher_type;
+
+    explicit
+        Basic_canteen(Monitor& _monitor, Canteen_config const& _config)
+        : m_config(_config)
+        , m_seat_capacity(std::max(_config.m_seat_capacity, _config.m_number_of_philosophers))
+        , m_p_clock(Execution_modes::simulation == _config.m_execution_mode
+                    ? static_cast<Clock*>(new Virtual_clock)
+                    : static_cast<Clock*>(new Steady_clock))
+        , m_policy(_config.m_number_of_philosophers)
+        , m_counters(m_seat_capacity)
+        , m_contiguous_forks(Layouts::contiguous == _config.m_layout ? number_of_forks(_config) : 0)
+        , m_contiguous_philosophers(Layouts::contiguous == _config.m_layout ? _config.m_number_of_philosophers : 0)
+        , m_affinity_map(Execution_modes::simulation == _config.m_execution_mode ? Affinities::none : _config.m_affinity,
+                         _config.m_first_seat,
+                         m_seat_capacity,
+                         _config.m_banquet_size,
+                         Execution_modes::pool == _config.m_execution_mode ? number_of_workers(_config) : 0)
+        , m_next_seat(_config.m_number_of_philosophers)
+        , m_is_running(false)
+        , m_run_time(0)
+        , m_p_monitor(&_monitor)
+    {
+        unsigned const _number_of_philosophers = _config.m_number_of_philosophers;
+
+        if (_number_of_philosophers < 2) {
+            throw std::invalid_argument("Invalid number of philosophers (<2)");
+        }
+
+        if (_config.m_p_script) {
+            if (Execution_modes::simulation != _config.m_execution_mode || _config.m_p_script->number_of_seats() != _number_of_philosophers) {
+                throw std::invalid_argument("Schedule script is replayed only in simulation mode with the recorded number of seats");
+            }
+
+            this->m_p_script.reset(new Schedule_script(*_config.m_p_script));
+        }
+
+        Topology const* const p_topology = _config.m_p_topology.get();
+
+        if (p_topology) {
+            if (!Policy::is_fork_set_supported) {
+                throw std::invalid_argument("Topology other than ring needs back-off or ordered policy");
+            }
+
+            if (p_topology->number_of_seats() != _number_of_philosophers || _config.m_p_script) {
+                throw std::invalid_argument("Topology should have the number of seats and could not replay schedule");
+            }
+        }
+
+        unsigned const _number_of_forks = number_of_forks(_config);
+        Sink const sink(_monitor);
+        this->m_forks.reserve(_number_of_forks);
+        // fork and philosopher are constructed on CPU of their seat, so first touch places them on its NUMA node
+        Thread_affinity_guard const affinity_guard;
+
+        for (unsigned i = 0; i < _number_of_forks; ++i) {
+            this->m_affinity_map.pin_seat(unsigned(std::uint64_t(i) * _number_of_philosophers / _number_of_forks));
+
+            if (Layouts::contiguous == _config.m_layout) {
+                this->m_forks.push_back(&this->m_contiguous_forks.emplace_back(i));
+            } else {
+                this->m_scattered_forks.emplace_back(new Fork(i));
+                this->m_forks.push_back(this->m_scattered_forks.back().get());
+            }
+        }
+
+        if (p_topology) {
+            this->m_fork_sets.reserve(p_topology->number_of_edges());
+
+            for (unsigned const fork : p_topology->forks()) {
+                this->m_fork_sets.push_back(this->m_forks[fork]);
+            }
+        }
+
+        this->m_philosophers.reserve(_number_of_philosophers);
+
+        for (unsigned i = 0; i < _number_of_philosophers; ++i) {
+            this->m_affinity_map.pin_seat(i);
+            Fork_range const forks = p_topology
+                                     ? Fork_range(this->m_fork_sets.data() + p_topology->offset(i), this->m_fork_sets.data() + p_topology->offset(i + 1))
+                                     : Fork_range(nullptr, nullptr);
+            Fork& left = p_topology ? forks[0] : *this->m_forks[i];
+            Fork& right = p_topology ? forks[forks.size() - 1] : *this->m_forks[(i + 1) % _number_of_philosophers];
+
+            if (Layouts::contiguous == _config.m_layout) {
+                this->m_philosophers.push_back(&this->m_contiguous_philosophers.emplace_back(
+                                                   i, _config.m_first_seat + i, left, right, this->m_policy, *this->m_p_clock, this->m_counters[i], sink));
+            } else {
+                this->m_scattered_philosophers.emplace_back(new philosopher_type(
+                            i, _config.m_first_seat + i, left, right, this->m_policy, *this->m_p_clock, this->m_counters[i], sink));
+                this->m_philosophers.push_back(this->m_scattered_philosophers.back().get());
+            }
+
+            if (p_topology) {
+                this->m_philosophers.back()->set_forks(forks);
+            }
+
+            this->m_philosophers.back()->set_script(this->m_p_script.get());
+            this->m_philosophers.back()->set_workload(_config.m_workload, _config.m_first_seat + i);
+        }
+
+        this->m_seating.m_fork_policy = _config.m_fork_policy;
+        this->m_seating.m_forks.reserve(_number_of_philosophers);
+
+        for (auto const& p_philosopher : this->m_philosophers) {
+            this->m_seating.m_forks.emplace_back(p_philosopher->left_fork().id(), p_philosopher->right_fork().id());
+        }
+
+        this->m_p_monitor->set_seating(this->m_seating);
+        this->m_p_monitor->attach_counters(&this->m_counters);
+    }
+
+    ~Basic_canteen()
+    {
+        this->m_p_monitor->attach_counters(nullptr);
+    }
+
+    Affinity_map const&
+        affinity_map()const override
+    {
+        return this->m_affinity_map;
+    }
+
+    /// @brief insert a new seat with its own fork into the ring after _after_seat, could be called while canteen runs
+    ///
+    /// Only the left neighbour is paused: it waits for its next thinking, its right fork is rewired to the new fork.
+    /// The new seat shares the former right fork of the neighbour.
+    /// @return id of the new seat, ids are not reused
+    /// @throw std::runtime_error if the canteen is stopped while the neighbour is paused, the ring is not changed
+    unsigned
+        add_seat(unsigned _after_seat) override
+    {
+        std::lock_guard<std::mutex> resize_lock(this->m_resize_mutex);
+        std::unique_lock<std::mutex> lock(this->m_ring_mutex);
+        check_resizable();
+
+        if (this->m_seat_capacity <= this->m_next_seat) {
+            throw std::invalid_argument("No free seats, capacity is " + std::to_string(this->m_seat_capacity));
+        }
+
+        std::size_t const position = ring_position(_after_seat);
+        philosopher_type& neighbour = *this->m_philosophers[position];
+
+        if (!pause(neighbour, lock)) {
+            throw std::runtime_error("Canteen is stopped, no seat is added after " + std::to_string(_after_seat));
+        }
+
+        unsigned const seat = this->m_next_seat++;
+        Sink const sink(*this->m_p_monitor);
+        this->m_scattered_forks.emplace_back(new Fork(seat));
+        Fork& fork = *this->m_scattered_forks.back();
+        this->m_scattered_philosophers.emplace_back(new philosopher_type(
+                    seat, this->m_config.m_first_seat + seat, fork, neighbour.right_fork(), this->m_policy, *this->m_p_clock, this->m_counters[seat], sink));
+        philosopher_type* const p_philosopher = this->m_scattered_philosophers.back().get();
+        p_philosopher->set_workload(this->m_config.m_workload, this->m_config.m_first_seat + seat);
+        neighbour.set_right_fork(fork);
+        neighbour.resume();
+        this->m_forks.push_back(&fork);
+        this->m_philosophers.insert(this->m_philosophers.begin() + std::ptrdiff_t(position + 1), p_philosopher);
+        // new seat logs its first events after the monitor is told about it
+        publish_seating();
+
+        if (this->m_is_running) {
+            this->m_threads.insert(this->m_threads.begin() + std::ptrdiff_t(position + 1), start_thread(p_philosopher));
+        }
+
+        return seat;
+    }
+
+    /// @brief stop the philosopher and take its seat and left fork out of the ring, could be called while canteen runs
+    ///
+    /// The left neighbour is paused to rewire its right fork to the right fork of the removed seat.
+    /// Counters of the removed seat are kept.
+    /// @throw std::runtime_error if the canteen is stopped while the neighbour is paused, the ring is not changed
+    void
+        remove_seat(unsigned _seat) override
+    {
+        std::lock_guard<std::mutex> resize_lock(this->m_resize_mutex);
+        std::unique_lock<std::mutex> lock(this->m_ring_mutex);
+        check_resizable();
+
+        if (this->m_philosophers.size() <= 2) {
+            throw std::invalid_argument("Ring could not be smaller than 2 seats");
+        }
+
+        std::size_t const position = ring_position(_seat);
+        std::size_t const size = this->m_philosophers.size();
+        philosopher_type& neighbour = *this->m_philosophers[(position + size - 1) % size];
+
+        // paused neighbour holds no forks, so the left fork of the seat is unused once the seat is stopped
+        if (!pause(neighbour, lock)) {
+            throw std::runtime_error("Canteen is stopped, seat " + std::to_string(_seat) + " is not removed");
+        }
+
+        philosopher_type* const p_philosopher = this->m_philosophers[position];
+        Fork* const p_fork = &p_philosopher->left_fork();
+
+        if (this->m_is_running) {
+            p_philosopher->kill();
+            p_philosopher->left_fork().interrupt();
+            p_philosopher->right_fork().interrupt();
+            this->m_policy.interrupt();
+            this->m_threads[position].join();
+            this->m_threads.erase(this->m_threads.begin() + std::ptrdiff_t(position));
+        }
+
+        neighbour.set_right_fork(p_philosopher->right_fork());
+        neighbour.resume();
+        this->m_philosophers.erase(this->m_philosophers.begin() + std::ptrdiff_t(position));
+        this->m_forks.erase(std::find(this->m_forks.begin(), this->m_forks.end(), p_fork));
+        erase_owned(this->m_scattered_philosophers, p_philosopher);
+        erase_owned(this->m_scattered_forks, p_fork);
+        std::vector<unsigned>& removed_seats = this->m_seating.m_removed_seats;
+        removed_seats.insert(std::upper_bound(removed_seats.begin(), removed_seats.end(), _seat), _seat);
+        publish_seating();
+    }
+
+    /// @brief ids of seats in ring order
+    std::vector<unsigned>
+        seats()const override
+    {
+        std::lock_guard<std::mutex> lock(this->m_ring_mutex);
+        std::vector<unsigned> result;
+
+        for (philosopher_type const* const p_philosopher : this->m_philosophers) {
+            result.push_back(p_philosopher->id());
+        }
+
+        return result;
+    }
+
+    void
+        operator()() override
+    {
+        switch (this->m_config.m_execution_mode) {
+        case Execution_modes::simulation:
+            // simulation ends normally after simulated duration or when all philosophers are dead
+            run_simulation();
+            return;
+
+        case Execution_modes::pool:
+            run_pool();
+            break;
+
+        default:
+            run_threads();
+            break;
+        }
+
+        throw std::logic_error("Unexpected exit");
+    }
+
+    /// @brief run for _duration (simulated time in simulation mode) or until meal quota and return normally
+    ///
+    /// Philosophers are stopped by fast cancellation, then events left in the queue are drained and the monitor is finished.
+    /// std::chrono::seconds::max() - no time limit, the run ends at meal quota (or when all are dead in simulation).
+    void
+        run_for(std::chrono::seconds _duration) override
+    {
+        Clock::time_point const start = this->m_p_clock->now();
+        check_meal_quota();
+
+        if (Execution_modes::simulation == this->m_config.m_execution_mode) {
+            Simulation<philosopher_type> simulation(this->m_philosophers, static_cast<Virtual_clock&>(*this->m_p_clock), *this->m_p_monitor);
+
+            if (this->m_config.has_meal_quota()) {
+                simulation.set_stop_condition([this]() {
+                    return is_meal_quota_reached();
+                }, g_max_interval);
+            }
+
+            simulation.run(std::chrono::seconds::max() == _duration ? std::chrono::seconds::zero() : _duration);
+            this->m_p_monitor->finish();
+            this->m_run_time = this->m_p_clock->now() - start;
+            return;
+        }
+
+        std::mutex mutex;
+        std::condition_variable finished_event;
+        bool is_finished = false;
+        std::thread stopper([&]() {
+            typedef std::chrono::steady_clock steady_clock;
+            steady_clock::time_point const end = std::chrono::seconds::max() == _duration
+                                                 ? steady_clock::time_point::max()
+                                                 : steady_clock::now() + _duration;
+            std::unique_lock<std::mutex> lock(mutex);
+
+            while (!is_finished) {
+                steady_clock::time_point const now = steady_clock::now();
+
+                if (end <= now || is_meal_quota_reached()) {
+                    break;
+                }
+
+                // quota is polled from counters, they are read without stopping philosophers
+                steady_clock::time_point const next = this->m_config.has_meal_quota()
+                                                      ? std::min(end, now + std::chrono::milliseconds(10))
+                                                      : end;
+
+                if (steady_clock::time_point::max() == next) {
+                    finished_event.wait(lock);
+                } else {
+                    finished_event.wait_until(lock, next);
+                }
+            }
+
+            this->m_p_monitor->request_stop();
+        });
+
+        if (Execution_modes::pool == this->m_config.m_execution_mode) {
+            run_pool();
+        } else {
+            run_threads();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            is_finished = true;
+        }
+        finished_event.notify_one();
+        stopper.join();
+        // events logged between the last drain and cancellation
+        this->m_p_monitor->finish();
+        this->m_run_time = this->m_p_clock->now() - start;
+    }
+
+    /// @brief clock time of the last run_for(), virtual time in simulation mode
+    Clock::time_point::duration
+        run_time()const override
+    {
+        return this->m_run_time;
+    }
+
+private:
+    void
+        run_threads()
+    {
+        try {
+            {
+                std::lock_guard<std::mutex> lock(this->m_ring_mutex);
+                this->m_threads.reserve(this->m_philosophers.size());
+                std::transform(this->m_philosophers.cbegin(), m_philosophers.cend(),
+                               std::back_inserter(this->m_threads),
+                               [this](philosopher_type* ptr) {
+                                   return start_thread(ptr);
+                               });
+                this->m_is_running = true;
+            }
+            wait_for_stop();
+        } catch (std::exception const& _excp) {
+            std::cerr << "Catch std::exception:" << _excp.what() << std::endl;
+        } catch (...) {
+            std::cerr << "Catch Unknown exception!" << std::endl;
+        }
+
+        std::vector<std::thread> threads;
+        {
+            std::lock_guard<std::mutex> lock(this->m_ring_mutex);
+            this->m_is_running = false;
+            stop_philosophers();
+            threads.swap(this->m_threads);
+        }
+
+        for (auto& thr : threads) {
+            thr.join();
+        }
+    }
+
+    std::thread
+        start_thread(philosopher_type* _p_philosopher)
+    {
+        return std::thread([this, _p_philosopher]() {
+            this->m_affinity_map.pin_seat(_p_philosopher->id());
+            philosopher_type::worker(_p_philosopher);
+        });
+    }
+
+    void
+        check_resizable()const
+    {
+        if (!Policy::is_ring_resizable || Execution_modes::threads != this->m_config.m_execution_mode || Layouts::scattered != this->m_config.m_layout
+                || this->m_config.m_p_topology) {
+            throw std::invalid_argument("Seats are added and removed only at a ring in threads mode with scattered layout and back-off or ordered policy");
+        }
+    }
+
+    /// @pre m_ring_mutex is locked
+    std::size_t
+        ring_position(unsigned _seat)const
+    {
+        for (std::size_t i = 0; i < this->m_philosophers.size(); ++i) {
+            if (this->m_philosophers[i]->id() == _seat) {
+                return i;
+            }
+        }
+
+        throw std::invalid_argument("Unknown seat " + std::to_string(_seat));
+    }
+
+    /// @brief pause running philosopher before its right fork is rewired, resume() lets it continue
+    ///
+    /// The wait could last a whole eating interval, so m_ring_mutex is released meanwhile and stop of the canteen is not held up.
+    /// m_resize_mutex keeps the ring unchanged.
+    /// @return false if the canteen is stopped meanwhile, philosopher could still use its forks
+    bool
+        pause(philosopher_type& _philosopher, std::unique_lock<std::mutex>& _ring_lock)
+    {
+        if (!this->m_is_running) {
+            return true;
+        }
+
+        _philosopher.request_pause();
+        _ring_lock.unlock();
+        bool const is_paused = _philosopher.wait_until_paused();
+        _ring_lock.lock();
+
+        if (is_paused && this->m_is_running) {
+            return true;
+        }
+
+        _philosopher.resume();
+        return false;
+    }
+
+    /// @brief forks of the ring after add_seat() or remove_seat() are passed to the consumer of the monitor
+    /// @pre m_ring_mutex is locked
+    void
+        publish_seating()
+    {
+        for (philosopher_type const* const p_philosopher : this->m_philosophers) {
+            if (this->m_seating.m_forks.size() <= p_philosopher->id()) {
+                this->m_seating.m_forks.resize(p_philosopher->id() + 1, std::make_pair(~0u, ~0u));
+            }
+
+            this->m_seating.m_forks[p_philosopher->id()] = std::make_pair(p_philosopher->left_fork().id(), p_philosopher->right_fork().id());
+        }
+
+        this->m_p_monitor->update_seating(this->m_seating);
+    }
+
+    template<typename Element>
+    static void
+        erase_owned(std::vector<std::unique_ptr<Element>>& _owners, Element const* _p_element)
+    {
+        _owners.erase(std::find_if(_owners.begin(), _owners.end(), [_p_element](std::unique_ptr<Element> const& _p_owned) {
+            return _p_owned.get() == _p_element;
+        }));
+    }
+
+    void
+        run_pool()
+    {
+        Scheduler<philosopher_type> scheduler(this->m_philosophers, number_of_workers(this->m_config), this->m_affinity_map);
+
+        try {
+            scheduler.start();
+            wait_for_stop();
+        } catch (std::exception const& _excp) {
+            std::cerr << "Catch std::exception:" << _excp.what() << std::endl;
+        } catch (...) {
+            std::cerr << "Catch Unknown exception!" << std::endl;
+        }
+
+        scheduler.stop();
+    }
+
+    /// @brief cooperative cancellation: kill everyone, then wake all blocked waits, so threads exit at once
+    void
+        stop_philosophers()
+    {
+        for (philosopher_type* const p : this->m_philosophers) {
+            p->kill();
+        }
+
+        for (Fork* const p_fork : this->m_forks) {
+            p_fork->interrupt();
+        }
+
+        this->m_policy.interrupt();
+    }
+
+    /// @brief monitored canteen runs monitor on the calling thread until it is stopped
+    void
+        wait_for_stop()
+    {
+        if (Sink::is_monitored) {
+            this->m_p_monitor->monitor_worker();
+        } else {
+            this->m_p_monitor->wait_for_stop();
+        }
+    }
+
+    static unsigned
+        number_of_forks(Canteen_config const& _config)
+    {
+        return _config.m_p_topology ? _config.m_p_topology->number_of_forks() : _config.m_number_of_philosophers;
+    }
+
+    static unsigned
+        number_of_workers(Canteen_config const& _config)
+    {
+        return std::max(1u, _config.m_number_of_workers ? _config.m_number_of_workers : std::thread::hardware_concurrency());
+    }
+
+    void
+        check_meal_quota()const
+    {
+#ifndef PHILOSOPHERS_COUNTERS
+
+        if (this->m_config.has_meal_quota()) {
+            throw std::invalid_argument("Meal quota needs counters, build with PHILOSOPHERS_COUNTERS");
+        }
+
+#endif
+    }
+
+    /// @brief meals are read from counters of philosophers, removed seats count only for the total
+    bool
+        is_meal_quota_reached()const
+    {
+        if (!this->m_config.has_meal_quota()) {
+            return false;
+        }
+
+        Counters_snapshot total;
+
+        for (auto const& counters : this->m_counters) {
+            counters.add_to(total);
+        }
+
+        if (0 != this->m_config.m_total_meals && this->m_config.m_total_meals <= total[Counters::meals]) {
+            return true;
+        }
+
+        if (0 == this->m_config.m_meals_per_philosopher) {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(this->m_ring_mutex);
+
+        for (philosopher_type const* const p_philosopher : this->m_philosophers) {
+            Counters_snapshot seat;
+            this->m_counters[p_philosopher->id()].add_to(seat);
+
+            if (seat[Counters::meals] < this->m_config.m_meals_per_philosopher) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void
+        run_simulation()
+    {
+        Simulation<philosopher_type> simulation(this->m_philosophers, static_cast<Virtual_clock&>(*this->m_p_clock), *this->m_p_monitor);
+        simulation.run(this->m_config.m_duration);
+        this->m_p_monitor->finish();
+    }
+
+    Canteen_config const m_config;
+    unsigned const m_seat_capacity;
+    std::unique_ptr<Clock> m_p_clock;
+    Policy m_policy;
+    Counters_table m_counters;
+    /// storage of Layouts::scattered, philosophers are destroyed before forks they refer to
+    std::vector<std::unique_ptr<Fork>> m_scattered_forks;
+    std::vector<std::unique_ptr<philosopher_type>> m_scattered_philosophers;
+    /// storage of Layouts::contiguous
+    Cache_aligned_array<Fork> m_contiguous_forks;
+    Cache_aligned_array<philosopher_type> m_contiguous_philosophers;
+    Affinity_map const m_affinity_map;
+    /// consumed by philosophers during the run
+    std::unique_ptr<Schedule_script> m_p_script;
+    /// forks in order of creation, philosophers in ring order
+    std::vector<Fork*> m_forks;
+    /// fork sets of topology seats laid out as Topology::forks(), empty for the ring
+    std::vector<Fork*> m_fork_sets;
+    std::vector<philosopher_type*> m_philosophers;
+    unsigned m_next_seat;
+    /// forks of every seat ever taken, removed seats keep their last forks
+    Seating m_seating;
+    /// add_seat() and remove_seat() one at a time, m_ring_mutex is released while they wait for a pause
+    std::mutex m_resize_mutex;
+    /// guards the ring and threads of philosophers against add_seat() and remove_seat()
+    std::mutex mutable m_ring_mutex;
+    /// thread of every philosopher in ring order while running in threads mode
+    std::vector<std::thread> m_threads;
+    bool m_is_running;
+    Clock::time_point::duration m_run_time;
+    Monitor* const m_p_monitor;
+};
+
+template<typename Policy, typename Starvation_policy>
+std::unique_ptr<Canteen_interface>
+make_canteen(Monitor& _monitor, Canteen_config const& _config)
+{
+    if (_config.m_is_monitored) {
+        return std::unique_ptr<Canteen_interface>(new Basic_canteen<Policy, Starvation_policy, Monitor_sink>(_monitor, _config));
+    }
+
+    return std::unique_ptr<Canteen_interface>(new Basic_canteen<Policy, Starvation_policy, Null_sink>(_monitor, _config));
+}
+
+template<typename Policy>
+std::unique_ptr<Canteen_interface>
+make_canteen(Monitor& _monitor, Canteen_config const& _config)
+{
+    if (_config.m_is_starvation_enabled) {
+        return make_canteen<Policy, Starvation>(_monitor, _config);
+    }
+
+    return make_canteen<Policy, No_starvation>(_monitor, _config);
+}
+
+/// @brief instantiation of Basic_canteen for fork policy, starvation and monitoring selected at runtime
+inline std::unique_ptr<Canteen_interface>
+make_canteen(Monitor& _monitor, Canteen_config const& _config)
+{
+    switch (_config.m_fork_policy) {
+    case Fork_policies::back_off:
+        return make_canteen<Back_off_policy>(_monitor, _config);
+
+    case Fork_policies::ordered:
+        return make_canteen<Ordered_policy>(_monitor, _config);
+
+    case Fork_policies::waiter:
+        return make_canteen<Waiter_policy>(_monitor, _config);
+
+    case Fork_policies::chandy_misra:
+        return make_canteen<Chandy_misra_policy>(_monitor, _config);
+
+    default:
+        throw std::invalid_argument("Invalid fork policy");
+    }
+}
+
+/// @brief canteen of configuration selected at runtime, see make_canteen()
+class Canteen
+{
+public:
+    explicit
+        Canteen(Monitor& _monitor, Canteen_config const& _config)
+        : m_p_canteen(make_canteen(_monitor, _config))
+    {}
+
+    /// @brief run until failure, simulation returns normally after simulated duration or when all philosophers are dead
+    void
+        operator()()
+    {
+        (*this->m_p_canteen)();
+    }
+
+    /// @brief see Basic_canteen::run_for()
+    void
+        run_for(std::chrono::seconds _duration)
+    {
+        this->m_p_canteen->run_for(_duration);
+    }
+
+    /// @brief clock time of the last run_for(), virtual time in simulation mode
+    Clock::time_point::duration
+        run_time()const
+    {
+        return this->m_p_canteen->run_time();
+    }
+
+    Affinity_map const&
+        affinity_map()const
+    {
+        return this->m_p_canteen->affinity_map();
+    }
+
+    /// @brief see Basic_canteen::add_seat()
+    unsigned
+        add_seat(unsigned _after_seat)
+    {
+        return this->m_p_canteen->add_seat(_after_seat);
+    }
+
+    /// @brief see Basic_canteen::remove_seat()
+    void
+        remove_seat(unsigned _seat)
+    {
+        this->m_p_canteen->remove_seat(_seat);
+    }
+
+    /// @brief ids of seats in ring order
+    std::vector<unsigned>
+        seats()const
+    {
+        return this->m_p_canteen->seats();
+    }
+
+private:
+    std::unique_ptr<Canteen_interface> const m_p_canteen;
+};
+
+}  // namespace philosophers
+
+#endif  // PHILOSOPHERS_CANTEEN_HPP_
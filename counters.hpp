@@ -0,0 +1,131 @@
+#ifndef PHILOSOPHERS_COUNTERS_HPP_
+#define PHILOSOPHERS_COUNTERS_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace philosophers {
+
+/// @brief hot path events and times counted per philosopher
+enum class Counters
+{
+    meals,
+    try_failures,
+    wait_timeouts,
+    back_off_retries,
+    spin_acquisitions,
+    thinking_ns,
+    hungry_ns,
+    dining_ns,
+    number_of_counters
+};
+
+inline char const*
+to_string(Counters _counter)
+{
+    switch (_counter) {
+    case Counters::meals:
+        return "meals";
+
+    case Counters::try_failures:
+        return "try_failures";
+
+    case Counters::wait_timeouts:
+        return "wait_timeouts";
+
+    case Counters::back_off_retries:
+        return "back_off_retries";
+
+    case Counters::spin_acquisitions:
+        return "spin_acquisitions";
+
+    case Counters::thinking_ns:
+        return "thinking_ns";
+
+    case Counters::hungry_ns:
+        return "hungry_ns";
+
+    case Counters::dining_ns:
+        return "dining_ns";
+
+    default:
+        return "?????";
+    }
+}
+
+static std::size_t const number_of_counters = std::size_t(Counters::number_of_counters);
+
+/// @brief aggregated values of counters
+struct Counters_snapshot
+{
+    Counters_snapshot()
+    {
+        this->m_values.fill(0);
+    }
+
+    std::uint64_t
+        operator[](Counters _counter)const
+    {
+        return this->m_values[std::size_t(_counter)];
+    }
+
+    std::array<std::uint64_t, number_of_counters> m_values;
+};
+
+/// @brief counters of one philosopher in its own cache line
+///
+/// Written only by the thread currently running the philosopher, so relaxed load and store are enough,
+/// readers aggregate blocks without stopping philosophers.
+/// Without PHILOSOPHERS_COUNTERS the block is empty and add() is compiled out.
+struct alignas(64) Philosopher_counters
+{
+    Philosopher_counters()
+    {
+#ifdef PHILOSOPHERS_COUNTERS
+
+        for (auto& value : this->m_values) {
+            value.store(0, std::memory_order_relaxed);
+        }
+
+#endif
+    }
+
+    void
+        add(Counters _counter, std::uint64_t _value = 1)
+    {
+#ifdef PHILOSOPHERS_COUNTERS
+        std::atomic<std::uint64_t>& value = this->m_values[std::size_t(_counter)];
+        value.store(value.load(std::memory_order_relaxed) + _value, std::memory_order_relaxed);
+#else
+        (void)_counter;
+        (void)_value;
+#endif
+    }
+
+    void
+        add_to(Counters_snapshot& _snapshot)const
+    {
+#ifdef PHILOSOPHERS_COUNTERS
+
+        for (std::size_t i = 0; i < number_of_counters; ++i) {
+            _snapshot.m_values[i] += this->m_values[i].load(std::memory_order_relaxed);
+        }
+
+#else
+        (void)_snapshot;
+#endif
+    }
+
+#ifdef PHILOSOPHERS_COUNTERS
+    std::atomic<std::uint64_t> m_values[number_of_counters];
+#endif
+};
+
+typedef std::vector<Philosopher_counters> Counters_table;
+
+}  // namespace philosophers
+
+#endif  // PHILOSOPHERS_COUNTERS_HPP_
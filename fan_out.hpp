@@ -0,0 +1,231 @@
+#ifndef PHILOSOPHERS_FAN_OUT_HPP_
+#define PHILOSOPHERS_FAN_OUT_HPP_
+
+#include "monitor.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace philosophers {
+
+/// @brief monitor draining the event queue once and passing every batch to several sink monitors
+///
+/// Drained batch is shared by all sinks without copying. Every sink consumes on its own thread
+/// from a bounded queue of batches, a batch is dropped for a sink whose queue is full,
+/// so a slow sink (e.g. terminal) never back-pressures philosophers or other sinks.
+/// When drained inline (Simulation, trace replay) nothing runs in real time, so full queue is waited for instead.
+/// Sinks are used only through Monitor::consume(), their own event queues stay empty.
+class Fan_out_monitor
+    : public Monitor
+{
+    /// @brief batch of events, new seating or end of the run, only batches are dropped
+    struct Item
+    {
+        Item()
+            : m_is_finished(false)
+        {}
+
+        std::shared_ptr<log_queue_type const> m_p_batch;
+        std::shared_ptr<Seating const> m_p_seating;
+        bool m_is_finished;
+    };
+
+    struct Sink
+    {
+        explicit
+            Sink(std::unique_ptr<Monitor> _p_monitor)
+            : m_p_monitor(std::move(_p_monitor))
+            , m_is_stopped(false)
+            , m_is_consuming(false)
+            , m_dropped_batches(0)
+        {}
+
+        std::unique_ptr<Monitor> const m_p_monitor;
+        std::mutex m_mutex;
+        std::condition_variable m_event;
+        std::condition_variable m_space_event;
+        std::deque<Item> m_items;
+        bool m_is_stopped;
+        /// item taken from m_items is being consumed
+        bool m_is_consuming;
+        std::atomic<std::uint64_t> m_dropped_batches;
+        std::thread m_thread;
+    };
+
+public:
+    /// @param _queue_capacity batches waiting for every sink
+    Fan_out_monitor(std::vector<std::unique_ptr<Monitor>> _sinks, Log_queue_config const& _log_queue = Log_queue_config(), unsigned _queue_capacity = 64)
+        : Monitor(_log_queue)
+        , m_queue_capacity(std::max(1u, _queue_capacity))
+    {
+        if (_sinks.empty()) {
+            throw std::invalid_argument("No sinks of fan-out monitor");
+        }
+
+        for (auto& p_monitor : _sinks) {
+            this->m_sinks.emplace_back(new Sink(std::move(p_monitor)));
+        }
+
+        for (auto const& p_sink : this->m_sinks) {
+            p_sink->m_thread = std::thread(&Fan_out_monitor::sink_worker, p_sink.get());
+        }
+    }
+
+    /// @brief sinks consume queued batches before they are destroyed
+    ~Fan_out_monitor()
+    {
+        for (auto const& p_sink : this->m_sinks) {
+            {
+                std::lock_guard<std::mutex> lock(p_sink->m_mutex);
+                p_sink->m_is_stopped = true;
+            }
+            p_sink->m_event.notify_one();
+        }
+
+        for (auto const& p_sink : this->m_sinks) {
+            p_sink->m_thread.join();
+        }
+    }
+
+    void
+        set_seating(Seating const& _seating) override
+    {
+        Item item;
+        item.m_p_seating = std::make_shared<Seating const>(_seating);
+        dispatch(item, false);
+    }
+
+    std::size_t
+        number_of_sinks()const
+    {
+        return this->m_sinks.size();
+    }
+
+    Monitor&
+        sink(std::size_t _index)const
+    {
+        return *this->m_sinks[_index]->m_p_monitor;
+    }
+
+    /// @brief wait until every sink consumed all queued items, e.g. before reading statistics of a finished run
+    void
+        wait_until_consumed()
+    {
+        for (auto const& p_sink : this->m_sinks) {
+            Sink const* const p_waited = p_sink.get();
+            std::unique_lock<std::mutex> lock(p_sink->m_mutex);
+            p_sink->m_space_event.wait(lock, [p_waited]() {
+                return p_waited->m_items.empty() && !p_waited->m_is_consuming;
+            });
+        }
+    }
+
+    /// @brief batches not delivered to sink because its queue was full
+    std::uint64_t
+        dropped_batches(std::size_t _index)const
+    {
+        return this->m_sinks[_index]->m_dropped_batches.load(std::memory_order_relaxed);
+    }
+
+protected:
+    void
+        events_logger(log_queue_type const& work_log)override
+    {
+        Item item;
+        item.m_p_batch = std::make_shared<log_queue_type const>(work_log);
+        dispatch(item, !is_drained_inline());
+    }
+
+    void
+        events_finished()override
+    {
+        Item item;
+        item.m_is_finished = true;
+        dispatch(item, false);
+    }
+
+private:
+    void
+        dispatch(Item const& _item, bool _is_droppable)
+    {
+        for (auto const& p_sink : this->m_sinks) {
+            {
+                std::unique_lock<std::mutex> lock(p_sink->m_mutex);
+
+                if (_is_droppable && this->m_queue_capacity <= p_sink->m_items.size()) {
+                    p_sink->m_dropped_batches.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+
+                if (_item.m_p_batch) {
+                    Sink const* const p_waited = p_sink.get();
+                    unsigned const capacity = this->m_queue_capacity;
+                    p_sink->m_space_event.wait(lock, [p_waited, capacity]() {
+                        return p_waited->m_items.size() < capacity;
+                    });
+                }
+
+                p_sink->m_items.push_back(_item);
+            }
+            p_sink->m_event.notify_one();
+        }
+    }
+
+    static void
+        sink_worker(Sink* _p_sink)
+    {
+        std::unique_lock<std::mutex> lock(_p_sink->m_mutex);
+
+        for (;;) {
+            _p_sink->m_event.wait(lock, [_p_sink]() {
+                return !_p_sink->m_items.empty() || _p_sink->m_is_stopped;
+            });
+
+            if (_p_sink->m_items.empty()) {
+                return;
+            }
+
+            Item const item = _p_sink->m_items.front();
+            _p_sink->m_items.pop_front();
+            _p_sink->m_is_consuming = true;
+            lock.unlock();
+            _p_sink->m_space_event.notify_all();
+
+            try {
+                if (item.m_p_seating) {
+                    _p_sink->m_p_monitor->set_seating(*item.m_p_seating);
+                } else if (item.m_is_finished) {
+                    _p_sink->m_p_monitor->finish();
+                } else {
+                    _p_sink->m_p_monitor->consume(*item.m_p_batch);
+                }
+            } catch (std::exception const& _excp) {
+                std::cerr << "Catch std::exception in fan-out sink: " << _excp.what() << std::endl;
+            }
+
+            lock.lock();
+            _p_sink->m_is_consuming = false;
+
+            if (_p_sink->m_items.empty()) {
+                _p_sink->m_space_event.notify_all();
+            }
+        }
+    }
+
+    unsigned const m_queue_capacity;
+    std::vector<std::unique_ptr<Sink>> m_sinks;
+};
+
+}  // namespace philosophers
+
+#endif  // PHILOSOPHERS_FAN_OUT_HPP_
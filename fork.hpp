@@ -0,0 +1,442 @@
+#ifndef PHILOSOPHERS_FORK_HPP_
+#define PHILOSOPHERS_FORK_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace {
+/// maximal thinking or eating interval, random intervals are multiples of g_interval_unit up to it
+std::chrono::nanoseconds g_max_interval = std::chrono::milliseconds(10000);
+std::chrono::nanoseconds g_interval_unit = std::chrono::milliseconds(1);
+/// thinking and eating burn CPU instead of sleeping
+bool g_is_spin_work = false;
+/// base seed of philosophers random generators
+unsigned g_seed = 0;
+/// fork waiters spin before parking while mean hold time of the fork is shorter, 0 - never spin
+unsigned g_spin_limit_us = 0;
+}
+
+namespace philosophers {
+
+/// @brief destructive interference size of target CPUs (std::hardware_destructive_interference_size is C++17)
+static std::size_t const cache_line_size = 64;
+
+/// @brief cooperative cancellation flag of a philosopher checked by its blocking waits
+///
+/// Waits check the flag in their predicates under their own mutex, so the one who requests stop
+/// wakes them by locking that mutex and notifying (see Fork::interrupt()).
+class Stop_token
+{
+public:
+    Stop_token()
+        : m_is_stop_requested(false)
+    {}
+
+    bool
+        stop_requested()const
+    {
+        return this->m_is_stop_requested.load(std::memory_order_acquire);
+    }
+
+    void
+        request_stop()
+    {
+        this->m_is_stop_requested.store(true, std::memory_order_release);
+    }
+
+private:
+    std::atomic<bool> m_is_stop_requested;
+};
+
+/// @brief hint to CPU that caller spins on a contested fork
+inline void
+cpu_relax()
+{
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+/// @brief exponentially weighted mean of fork hold times for adaptive spinning of waiters
+///
+/// Measured only if spinning is enabled (g_spin_limit_us), updates are racy but the mean is only a hint.
+class Hold_time
+{
+public:
+    Hold_time()
+        : m_taken_at(0)
+        , m_mean_ns(0)
+    {}
+
+    void
+        taken()
+    {
+        if (0 != g_spin_limit_us) {
+            this->m_taken_at.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+        }
+    }
+
+    void
+        freed()
+    {
+        if (0 != g_spin_limit_us) {
+            std::int64_t const sample = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::duration(std::chrono::steady_clock::now().time_since_epoch().count() - this->m_taken_at.load(std::memory_order_relaxed))).count();
+            std::int64_t const mean = this->m_mean_ns.load(std::memory_order_relaxed);
+            this->m_mean_ns.store(mean + (sample - mean) / 8, std::memory_order_relaxed);
+        }
+    }
+
+    std::chrono::nanoseconds
+        mean()const
+    {
+        return std::chrono::nanoseconds(this->m_mean_ns.load(std::memory_order_relaxed));
+    }
+
+private:
+    std::atomic<std::chrono::steady_clock::rep> m_taken_at;
+    std::atomic<std::int64_t> m_mean_ns;
+};
+
+/// @brief fork guarded by mutex, waiters park on condition variable
+class Mutex_fork
+{
+public:
+    Mutex_fork(unsigned _id)
+        : m_id(_id)
+        , m_is_available(true)
+    {}
+
+    static char const*
+        name()
+    {
+        return "mutex";
+    }
+
+    unsigned
+        id() const
+    {
+        return m_id;
+    }
+
+    /// @brief expected time until holder frees the fork, 0 - not measured
+    std::chrono::nanoseconds
+        mean_hold_time()const
+    {
+        return this->m_hold_time.mean();
+    }
+
+    bool
+        try_to_get()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        if (this->m_is_available) {
+            this->m_is_available = false;
+            this->m_hold_time.taken();
+            return true;
+        }
+
+        return false;
+    }
+
+    /// @brief park until the fork is free, _deadline passes or stop is requested
+    ///
+    /// Predicate is re-checked after every wakeup, so spurious wakeups do not end the wait early.
+    /// @return false on deadline or stop request
+    bool
+        wait_until_available(std::chrono::steady_clock::time_point _deadline, Stop_token const& _stop_token)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        this->m_conditional_variable.wait_until(lock, _deadline, [this, &_stop_token]() {
+            return this->m_is_available || _stop_token.stop_requested();
+        });
+
+        if (this->m_is_available) {
+            this->m_is_available = false;
+            this->m_hold_time.taken();
+            return true;
+        }
+
+        return false;
+    }
+
+    void
+        free()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        this->m_hold_time.freed();
+        this->m_is_available = true;
+        this->m_conditional_variable.notify_one();
+    }
+
+    /// @brief wake all waiters to check their stop tokens
+    void
+        interrupt()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+        }
+        this->m_conditional_variable.notify_all();
+    }
+
+private:
+    unsigned m_id;
+    bool volatile m_is_available;
+    Hold_time m_hold_time;
+    std::mutex m_mutex;
+    std::condition_variable m_conditional_variable;
+};
+
+/// @brief fork with lock-free compare-exchange fast path
+///
+/// Mutex and condition variable are touched only when the fork is contested:
+/// waiters register in m_waiters, and free() notifies only if someone is parked.
+class Atomic_fork
+{
+public:
+    Atomic_fork(unsigned _id)
+        : m_id(_id)
+        , m_is_available(true)
+        , m_waiters(0)
+    {}
+
+    static char const*
+        name()
+    {
+        return "atomic";
+    }
+
+    unsigned
+        id() const
+    {
+        return m_id;
+    }
+
+    /// @brief expected time until holder frees the fork, 0 - not measured
+    std::chrono::nanoseconds
+        mean_hold_time()const
+    {
+        return this->m_hold_time.mean();
+    }
+
+    bool
+        try_to_get()
+    {
+        // test before compare-exchange to avoid bouncing the cache line of a taken fork
+        return this->m_is_available.load(std::memory_order_relaxed) && this->exchange_available();
+    }
+
+    /// @brief park until the fork is taken, _deadline passes or stop is requested
+    ///
+    /// Predicate is re-checked after every wakeup, so spurious wakeups do not end the wait early.
+    /// @return false on deadline or stop request
+    bool
+        wait_until_available(std::chrono::steady_clock::time_point _deadline, Stop_token const& _stop_token)
+    {
+        if (this->try_to_get()) {
+            return true;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        this->m_waiters.fetch_add(1);
+        bool is_taken = false;
+        this->m_conditional_variable.wait_until(lock, _deadline, [this, &_stop_token, &is_taken]() {
+            is_taken = this->exchange_available();
+            return is_taken || _stop_token.stop_requested();
+        });
+        this->m_waiters.fetch_sub(1, std::memory_order_relaxed);
+        return is_taken;
+    }
+
+    void
+        free()
+    {
+        this->m_hold_time.freed();
+        this->m_is_available.store(true);
+
+        if (0 != this->m_waiters.load()) {
+            // waiter holds the mutex between registration and parking, so taking it here prevents lost wakeup
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+            }
+            this->m_conditional_variable.notify_one();
+        }
+    }
+
+    /// @brief wake all waiters to check their stop tokens
+    void
+        interrupt()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+        }
+        this->m_conditional_variable.notify_all();
+    }
+
+private:
+    bool
+        exchange_available()
+    {
+        bool expected = true;
+
+        if (this->m_is_available.compare_exchange_strong(expected, false)) {
+            this->m_hold_time.taken();
+            return true;
+        }
+
+        return false;
+    }
+
+    unsigned m_id;
+    std::atomic<bool> m_is_available;
+    Hold_time m_hold_time;
+    std::atomic<unsigned> m_waiters;
+    std::mutex m_mutex;
+    std::condition_variable m_conditional_variable;
+};
+
+/// @brief fair fork, released fork is handed directly to the longest waiting philosopher
+///
+/// Waiters queue in arrival order, each parks on its own condition variable, so free() wakes only the next one.
+/// try_to_get() succeeds only if nobody waits, so neighbours can not barge in ahead of the queue
+/// and hunger latency is bounded by the holds of waiters ahead.
+class Fifo_fork
+{
+public:
+    Fifo_fork(unsigned _id)
+        : m_id(_id)
+        , m_is_available(true)
+    {}
+
+    static char const*
+        name()
+    {
+        return "fifo";
+    }
+
+    unsigned
+        id() const
+    {
+        return m_id;
+    }
+
+    /// @brief expected time until holder frees the fork, 0 - not measured
+    std::chrono::nanoseconds
+        mean_hold_time()const
+    {
+        return this->m_hold_time.mean();
+    }
+
+    bool
+        try_to_get()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (this->m_is_available && this->m_waiters.empty()) {
+            this->m_is_available = false;
+            this->m_hold_time.taken();
+            return true;
+        }
+
+        return false;
+    }
+
+    /// @brief queue up and park until the fork is handed over, _deadline passes or stop is requested
+    ///
+    /// Predicate is re-checked after every wakeup, so spurious wakeups do not end the wait early.
+    /// Waiter leaving on deadline or stop request gives up its place in the queue.
+    /// @return false on deadline or stop request
+    bool
+        wait_until_available(std::chrono::steady_clock::time_point _deadline, Stop_token const& _stop_token)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        if (this->m_is_available && this->m_waiters.empty()) {
+            this->m_is_available = false;
+            this->m_hold_time.taken();
+            return true;
+        }
+
+        Waiter waiter;
+        this->m_waiters.push_back(&waiter);
+        waiter.m_handed_over.wait_until(lock, _deadline, [&waiter, &_stop_token]() {
+            return waiter.m_is_handed_over || _stop_token.stop_requested();
+        });
+
+        if (waiter.m_is_handed_over) {
+            this->m_hold_time.taken();
+            return true;
+        }
+
+        this->m_waiters.erase(std::find(this->m_waiters.begin(), this->m_waiters.end(), &waiter));
+        return false;
+    }
+
+    void
+        free()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        this->m_hold_time.freed();
+
+        if (this->m_waiters.empty()) {
+            this->m_is_available = true;
+            return;
+        }
+
+        // fork stays taken, ownership passes to the head of the queue
+        Waiter* const p_next = this->m_waiters.front();
+        this->m_waiters.pop_front();
+        p_next->m_is_handed_over = true;
+        p_next->m_handed_over.notify_one();
+    }
+
+    /// @brief wake all waiters to check their stop tokens
+    void
+        interrupt()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for (Waiter* const p_waiter : this->m_waiters) {
+            p_waiter->m_handed_over.notify_one();
+        }
+    }
+
+private:
+    struct Waiter
+    {
+        Waiter()
+            : m_is_handed_over(false)
+        {}
+
+        bool m_is_handed_over;
+        std::condition_variable m_handed_over;
+    };
+
+    unsigned m_id;
+    bool m_is_available;
+    std::deque<Waiter*> m_waiters;
+    Hold_time m_hold_time;
+    std::mutex m_mutex;
+};
+
+#if defined(PHILOSOPHERS_FIFO_FORK)
+typedef Fifo_fork Fork;
+#elif defined(PHILOSOPHERS_ATOMIC_FORK)
+typedef Atomic_fork Fork;
+#else
+typedef Mutex_fork Fork;
+#endif
+
+}  // namespace philosophers
+
+#endif  // PHILOSOPHERS_FORK_HPP_
@@ -0,0 +1,612 @@
+#ifndef PHILOSOPHERS_FORK_POLICY_HPP_
+#define PHILOSOPHERS_FORK_POLICY_HPP_
+
+#include "philosopher.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace philosophers {
+
+/// @brief all-or-nothing acquisition of fork sets of topologies other than ring, see Philosopher::forks()
+///
+/// Waits are blocking on one fork at a time, the rest of the set is taken in a batch of try_to_get().
+class Fork_set_acquisition
+{
+public:
+    /// @brief resource hierarchy over any graph: forks are waited for in ascending id order, so waits form no cycle
+    template<typename Philosopher_type>
+    static bool
+        aquire_ordered(Philosopher_type& _philosopher)
+    {
+        Fork_range const& forks = _philosopher.forks();
+
+        for (std::size_t i = 0; i < forks.size(); ++i) {
+            while (!_philosopher.wait_until_available(forks[i])) {
+                if (_philosopher.is_waiting_cancelled()) {
+                    free_range(forks, 0, i);
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    /// @brief wait for one fork, try the rest; on failure return all and wait for the busy one next round
+    template<typename Philosopher_type>
+    static bool
+        aquire_back_off(Philosopher_type& _philosopher)
+    {
+        Fork_range const& forks = _philosopher.forks();
+        std::size_t first = 0;
+
+        for (;;) {
+            while (!_philosopher.wait_until_available(forks[first])) {
+                if (_philosopher.is_waiting_cancelled()) {
+                    return false;
+                }
+            }
+
+            std::size_t const busy = try_rest(_philosopher, first);
+
+            if (busy == forks.size()) {
+                return true;
+            }
+
+            forks[first].free();
+            _philosopher.counters().add(Counters::back_off_retries);
+
+            if (_philosopher.is_waiting_cancelled()) {
+                return false;
+            }
+
+            first = busy;
+        }
+    }
+
+    /// @brief one batch of try_to_get() in ascending id order, taken forks are returned on failure
+    template<typename Philosopher_type>
+    static bool
+        try_aquire(Philosopher_type& _philosopher)
+    {
+        Fork_range const& forks = _philosopher.forks();
+
+        if (!_philosopher.try_to_get(forks[0])) {
+            return false;
+        }
+
+        if (try_rest(_philosopher, 0) == forks.size()) {
+            return true;
+        }
+
+        forks[0].free();
+        return false;
+    }
+
+    template<typename Philosopher_type>
+    static void
+        release(Philosopher_type& _philosopher)
+    {
+        Fork_range const& forks = _philosopher.forks();
+        free_range(forks, 0, forks.size());
+    }
+
+private:
+    /// @brief try forks after _first cyclically, _first is held
+    /// @return size of the set if all are taken, otherwise index of the busy fork, forks taken here are returned
+    template<typename Philosopher_type>
+    static std::size_t
+        try_rest(Philosopher_type& _philosopher, std::size_t _first)
+    {
+        Fork_range const& forks = _philosopher.forks();
+        std::size_t const size = forks.size();
+
+        for (std::size_t i = 1; i < size; ++i) {
+            std::size_t const index = (_first + i) % size;
+
+            if (!_philosopher.try_to_get(forks[index])) {
+                for (std::size_t j = 1; j < i; ++j) {
+                    forks[(_first + j) % size].free();
+                }
+
+                return index;
+            }
+        }
+
+        return size;
+    }
+
+    /// @brief forks [_begin, _end) in reverse order
+    static void
+        free_range(Fork_range const& _forks, std::size_t _begin, std::size_t _end)
+    {
+        while (_end-- > _begin) {
+            _forks[_end].free();
+        }
+    }
+};
+
+/// @brief take one fork, try the other one, on failure return the first and retry in the opposite order
+class Back_off_policy
+    : public Fork_policy
+{
+public:
+    explicit
+        Back_off_policy(unsigned)
+    {}
+
+    static bool const is_ring_resizable = true;
+    static bool const is_fork_set_supported = true;
+
+    template<typename Philosopher_type>
+    bool
+        aquire(Philosopher_type& _philosopher)
+    {
+        if (_philosopher.has_fork_set()) {
+            return Fork_set_acquisition::aquire_back_off(_philosopher);
+        }
+
+        Fork& left = _philosopher.left_fork();
+        Fork& right = _philosopher.right_fork();
+
+        for (;;) {
+            while (!_philosopher.wait_until_available(left)) {
+                if (_philosopher.is_waiting_cancelled()) {
+                    return false;
+                }
+            }
+
+            if (_philosopher.try_to_get(right)) {
+                return true;
+            }
+
+            left.free();
+            _philosopher.counters().add(Counters::back_off_retries);
+
+            if (_philosopher.is_waiting_cancelled()) {
+                return false;
+            }
+
+            while (!_philosopher.wait_until_available(right)) {
+                if (_philosopher.is_waiting_cancelled()) {
+                    return false;
+                }
+            }
+
+            if (_philosopher.try_to_get(left)) {
+                return true;
+            }
+
+            right.free();
+            _philosopher.counters().add(Counters::back_off_retries);
+
+            if (_philosopher.is_waiting_cancelled()) {
+                return false;
+            }
+        }
+    }
+
+    template<typename Philosopher_type>
+    bool
+        try_aquire(Philosopher_type& _philosopher)
+    {
+        if (_philosopher.has_fork_set()) {
+            return Fork_set_acquisition::try_aquire(_philosopher);
+        }
+
+        Fork& left = _philosopher.left_fork();
+
+        if (!_philosopher.try_to_get(left)) {
+            return false;
+        }
+
+        if (_philosopher.try_to_get(_philosopher.right_fork())) {
+            return true;
+        }
+
+        left.free();
+        return false;
+    }
+
+    template<typename Philosopher_type>
+    void
+        release(Philosopher_type& _philosopher)
+    {
+        if (_philosopher.has_fork_set()) {
+            Fork_set_acquisition::release(_philosopher);
+            return;
+        }
+
+        _philosopher.right_fork().free();
+        _philosopher.left_fork().free();
+    }
+};
+
+/// @brief resource hierarchy: fork with the lowest id is always taken first
+class Ordered_policy
+    : public Fork_policy
+{
+public:
+    explicit
+        Ordered_policy(unsigned)
+    {}
+
+    static bool const is_ring_resizable = true;
+    static bool const is_fork_set_supported = true;
+
+    template<typename Philosopher_type>
+    bool
+        aquire(Philosopher_type& _philosopher)
+    {
+        if (_philosopher.has_fork_set()) {
+            return Fork_set_acquisition::aquire_ordered(_philosopher);
+        }
+
+        Fork* p_first = &_philosopher.left_fork();
+        Fork* p_second = &_philosopher.right_fork();
+
+        if (p_second->id() < p_first->id()) {
+            std::swap(p_first, p_second);
+        }
+
+        while (!_philosopher.wait_until_available(*p_first)) {
+            if (_philosopher.is_waiting_cancelled()) {
+                return false;
+            }
+        }
+
+        while (!_philosopher.wait_until_available(*p_second)) {
+            if (_philosopher.is_waiting_cancelled()) {
+                p_first->free();
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /// @note suspended philosopher does not hold the first fork, it is returned if the second one is busy
+    template<typename Philosopher_type>
+    bool
+        try_aquire(Philosopher_type& _philosopher)
+    {
+        if (_philosopher.has_fork_set()) {
+            return Fork_set_acquisition::try_aquire(_philosopher);
+        }
+
+        Fork* p_first = &_philosopher.left_fork();
+        Fork* p_second = &_philosopher.right_fork();
+
+        if (p_second->id() < p_first->id()) {
+            std::swap(p_first, p_second);
+        }
+
+        if (!_philosopher.try_to_get(*p_first)) {
+            return false;
+        }
+
+        if (_philosopher.try_to_get(*p_second)) {
+            return true;
+        }
+
+        p_first->free();
+        return false;
+    }
+
+    template<typename Philosopher_type>
+    void
+        release(Philosopher_type& _philosopher)
+    {
+        if (_philosopher.has_fork_set()) {
+            Fork_set_acquisition::release(_philosopher);
+            return;
+        }
+
+        _philosopher.right_fork().free();
+        _philosopher.left_fork().free();
+    }
+};
+
+/// @brief central arbitrator: both forks are granted at once under the waiter lock
+class Waiter_policy
+    : public Fork_policy
+{
+public:
+    explicit
+        Waiter_policy(unsigned _number_of_seats)
+        : m_seats(_number_of_seats)
+    {}
+
+    template<typename Philosopher_type>
+    bool
+        aquire(Philosopher_type& _philosopher)
+    {
+        std::unique_lock<decltype(m_mutex)> lock(m_mutex);
+        bool is_granted = false;
+        auto const is_woken = [&_philosopher, &is_granted]() {
+            is_granted = both_taken(_philosopher);
+            return is_granted || _philosopher.is_stop_requested();
+        };
+
+        while (!this->m_seats[_philosopher.id()].wait_until(lock, _philosopher.wait_deadline(), is_woken)) {
+            _philosopher.counters().add(Counters::wait_timeouts);
+
+            if (_philosopher.is_waiting_cancelled()) {
+                return false;
+            }
+        }
+
+        return is_granted;
+    }
+
+    template<typename Philosopher_type>
+    bool
+        try_aquire(Philosopher_type& _philosopher)
+    {
+        std::lock_guard<decltype(m_mutex)> lock(m_mutex);
+        return both_taken(_philosopher);
+    }
+
+    template<typename Philosopher_type>
+    void
+        release(Philosopher_type& _philosopher)
+    {
+        unsigned const size = unsigned(this->m_seats.size());
+        unsigned const id = _philosopher.id();
+        {
+            std::lock_guard<decltype(m_mutex)> lock(m_mutex);
+            _philosopher.right_fork().free();
+            _philosopher.left_fork().free();
+        }
+        // only neighbours share forks with the philosopher
+        this->m_seats[(id + size - 1) % size].notify_one();
+        this->m_seats[(id + 1) % size].notify_one();
+    }
+
+    void
+        interrupt()
+    {
+        {
+            std::lock_guard<decltype(m_mutex)> lock(m_mutex);
+        }
+
+        for (auto& seat : this->m_seats) {
+            seat.notify_all();
+        }
+    }
+
+private:
+    template<typename Philosopher_type>
+    static bool
+        both_taken(Philosopher_type& _philosopher)
+    {
+        Fork& left = _philosopher.left_fork();
+
+        if (!_philosopher.try_to_get(left)) {
+            return false;
+        }
+
+        if (_philosopher.try_to_get(_philosopher.right_fork())) {
+            return true;
+        }
+
+        left.free();
+        return false;
+    }
+
+    std::mutex m_mutex;
+    std::vector<std::condition_variable> m_seats;
+};
+
+/// @brief Chandy-Misra solution: dirty forks are handed over on request, clean ones are kept
+///
+/// Requests are not sent as messages: a hungry philosopher takes a neighbour's fork itself
+/// as soon as it is dirty and not in use. Taken fork becomes clean, after meal both forks become dirty.
+/// Initially every fork is dirty and belongs to the neighbour with the lower id, so precedence graph is acyclic.
+class Chandy_misra_policy
+    : public Fork_policy
+{
+    struct Fork_state
+    {
+        std::mutex m_mutex;
+        std::condition_variable m_released;
+        unsigned m_owner;
+        bool m_is_dirty;
+        bool m_in_use;
+    };
+
+public:
+    explicit
+        Chandy_misra_policy(unsigned _number_of_forks)
+        : m_forks(_number_of_forks)
+    {
+        for (unsigned i = 0; i < _number_of_forks; ++i) {
+            // fork #i is shared by philosophers #i (left) and #i-1 (right)
+            this->m_forks[i].m_owner = std::min(i, (i + _number_of_forks - 1) % _number_of_forks);
+            this->m_forks[i].m_is_dirty = true;
+            this->m_forks[i].m_in_use = false;
+        }
+    }
+
+    template<typename Philosopher_type>
+    bool
+        aquire(Philosopher_type& _philosopher)
+    {
+        unsigned const id = _philosopher.id();
+        Fork_state& left = this->m_forks[_philosopher.left_fork().id()];
+        Fork_state& right = this->m_forks[_philosopher.right_fork().id()];
+
+        for (;;) {
+            // forks owned but not in use stay with the philosopher, leave() makes them dirty
+            if (!take(left, _philosopher) || !take(right, _philosopher)) {
+                return false;
+            }
+
+            // own dirty fork could be handed over while waiting for the other one
+            std::unique_lock<std::mutex> left_lock(left.m_mutex, std::defer_lock);
+            std::unique_lock<std::mutex> right_lock(right.m_mutex, std::defer_lock);
+            std::lock(left_lock, right_lock);
+
+            if (left.m_owner == id && right.m_owner == id) {
+                left.m_in_use = true;
+                right.m_in_use = true;
+                break;
+            }
+        }
+
+        take_forks(_philosopher);
+        return true;
+    }
+
+    template<typename Philosopher_type>
+    bool
+        try_aquire(Philosopher_type& _philosopher)
+    {
+        unsigned const id = _philosopher.id();
+        Fork_state& left = this->m_forks[_philosopher.left_fork().id()];
+        Fork_state& right = this->m_forks[_philosopher.right_fork().id()];
+        std::unique_lock<std::mutex> left_lock(left.m_mutex, std::defer_lock);
+        std::unique_lock<std::mutex> right_lock(right.m_mutex, std::defer_lock);
+        std::lock(left_lock, right_lock);
+
+        // clean forks obtained here are kept by hungry philosopher until its meal
+        if (!(try_take(left, id) && try_take(right, id))) {
+            return false;
+        }
+
+        left.m_in_use = true;
+        right.m_in_use = true;
+        left_lock.unlock();
+        right_lock.unlock();
+        take_forks(_philosopher);
+        return true;
+    }
+
+    template<typename Philosopher_type>
+    void
+        release(Philosopher_type& _philosopher)
+    {
+        Fork& left = _philosopher.left_fork();
+        Fork& right = _philosopher.right_fork();
+        right.free();
+        left.free();
+        put(this->m_forks[right.id()]);
+        put(this->m_forks[left.id()]);
+    }
+
+    /// @brief clean forks of the philosopher become dirty, so neighbours can take them
+    template<typename Philosopher_type>
+    void
+        leave(Philosopher_type& _philosopher)
+    {
+        for (Fork_state* const p_fork : {&this->m_forks[_philosopher.left_fork().id()], &this->m_forks[_philosopher.right_fork().id()]}) {
+            {
+                std::lock_guard<std::mutex> lock(p_fork->m_mutex);
+
+                if (p_fork->m_owner == _philosopher.id()) {
+                    p_fork->m_is_dirty = true;
+                }
+            }
+            p_fork->m_released.notify_all();
+        }
+    }
+
+    void
+        interrupt()
+    {
+        for (Fork_state& fork : this->m_forks) {
+            {
+                std::lock_guard<std::mutex> lock(fork.m_mutex);
+            }
+            fork.m_released.notify_all();
+        }
+    }
+
+private:
+    template<typename Philosopher_type>
+    static void
+        take_forks(Philosopher_type& _philosopher)
+    {
+        bool const is_taken = _philosopher.left_fork().try_to_get() && _philosopher.right_fork().try_to_get();
+
+        if (!is_taken) {
+            throw std::logic_error("Chandy-Misra fork ownership violated");
+        }
+    }
+
+    /// @pre _fork.m_mutex is locked
+    static bool
+        try_take(Fork_state& _fork, unsigned _id)
+    {
+        if (_fork.m_owner == _id) {
+            return true;
+        }
+
+        if (!_fork.m_is_dirty || _fork.m_in_use) {
+            return false;
+        }
+
+        _fork.m_owner = _id;
+        _fork.m_is_dirty = false;
+        return true;
+    }
+
+    /// @return false if waiting is cancelled
+    template<typename Philosopher_type>
+    static bool
+        take(Fork_state& _fork, Philosopher_type& _philosopher)
+    {
+        unsigned const id = _philosopher.id();
+        std::unique_lock<std::mutex> lock(_fork.m_mutex);
+        auto const is_obtainable = [&_fork, id]() {
+            return _fork.m_owner == id || (_fork.m_is_dirty && !_fork.m_in_use);
+        };
+        auto const is_woken = [&is_obtainable, &_philosopher]() {
+            return is_obtainable() || _philosopher.is_stop_requested();
+        };
+
+        while (!_fork.m_released.wait_until(lock, _philosopher.wait_deadline(), is_woken)) {
+            lock.unlock();
+            _philosopher.counters().add(Counters::wait_timeouts);
+
+            if (_philosopher.is_waiting_cancelled()) {
+                return false;
+            }
+
+            lock.lock();
+        }
+
+        if (!is_obtainable()) {
+            return false;
+        }
+
+        if (_fork.m_owner != id) {
+            _fork.m_owner = id;
+            _fork.m_is_dirty = false;
+        }
+
+        return true;
+    }
+
+    static void
+        put(Fork_state& _fork)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_fork.m_mutex);
+            _fork.m_in_use = false;
+            _fork.m_is_dirty = true;
+        }
+        _fork.m_released.notify_all();
+    }
+
+    std::vector<Fork_state> m_forks;
+};
+
+}  // namespace philosophers
+
+#endif  // PHILOSOPHERS_FORK_POLICY_HPP_
@@ -0,0 +1,284 @@
+#ifndef PHILOSOPHERS_METRICS_HPP_
+#define PHILOSOPHERS_METRICS_HPP_
+
+#include "fan_out.hpp"
+#include "statistics.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace philosophers {
+
+/// @brief Prometheus text exposition of a running canteen served over HTTP on loopback
+///
+/// GET /metrics renders counters of philosophers, histograms of Statistics_monitor
+/// and queue state of the monitor. Everything is read from relaxed atomics,
+/// so a scrape takes neither the log queue mutex nor any fork and does not change contention.
+/// Monitor, its counters and statistics must outlive the server.
+class Metrics_server
+{
+public:
+    /// @param _port 0 - any free port, see port()
+    /// @param _p_statistics nullptr - no histograms
+    Metrics_server(unsigned _port, Monitor const& _monitor, Statistics_monitor const* _p_statistics)
+        : m_monitor(_monitor)
+        , m_p_statistics(_p_statistics)
+        , m_fd(::socket(AF_INET, SOCK_STREAM, 0))
+        , m_port(0)
+        , m_is_stopped(false)
+    {
+        if (this->m_fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "Can not create metrics socket");
+        }
+
+        int const reuse = 1;
+        ::setsockopt(this->m_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof reuse);
+        sockaddr_in address;
+        std::memset(&address, 0, sizeof address);
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(std::uint16_t(_port));
+        socklen_t size = sizeof address;
+
+        if (0 != ::bind(this->m_fd, reinterpret_cast<sockaddr const*>(&address), sizeof address)
+                || 0 != ::listen(this->m_fd, 8)
+                || 0 != ::getsockname(this->m_fd, reinterpret_cast<sockaddr*>(&address), &size)) {
+            int const error = errno;
+            ::close(this->m_fd);
+            throw std::system_error(error, std::generic_category(), "Can not listen for metrics on port " + std::to_string(_port));
+        }
+
+        this->m_port = ntohs(address.sin_port);
+        this->m_thread = std::thread(&Metrics_server::serve, this);
+    }
+
+    Metrics_server(Metrics_server const&) = delete;
+    Metrics_server& operator=(Metrics_server const&) = delete;
+
+    ~Metrics_server()
+    {
+        this->m_is_stopped.store(true);
+        this->m_thread.join();
+        ::close(this->m_fd);
+    }
+
+    unsigned
+        port()const
+    {
+        return this->m_port;
+    }
+
+    /// @brief current metrics in Prometheus text format
+    std::string
+        render()const
+    {
+        std::string result;
+        result.reserve(1u << 14);
+
+#ifdef PHILOSOPHERS_COUNTERS
+        std::size_t const number_of_seats = this->m_monitor.number_of_counted_seats();
+
+        // tables of Banquet count on their own monitors, so seats of the aggregated monitor are not counted
+        for (std::size_t i = 0; i < number_of_counters && number_of_seats; ++i) {
+            std::string const name = std::string("philosophers_") + to_string(Counters(i)) + "_total";
+            result += "# TYPE " + name + " counter\n";
+
+            for (unsigned seat = 0; seat < number_of_seats; ++seat) {
+                result += name + "{seat=\"" + std::to_string(seat) + "\"} "
+                          + std::to_string(this->m_monitor.counters_snapshot(seat).m_values[i]) + "\n";
+            }
+        }
+
+#endif
+
+        if (this->m_p_statistics) {
+            Statistics_monitor const& statistics = *this->m_p_statistics;
+            metric(result, "philosophers_deaths_total", "counter", statistics.deaths());
+            metric(result, "philosophers_near_misses_total", "counter", statistics.near_misses());
+            histogram(result, "philosophers_hunger_seconds", statistics.hunger());
+            histogram(result, "philosophers_thinking_seconds", statistics.thinking());
+            histogram(result, "philosophers_dining_seconds", statistics.dining());
+        }
+
+        if (Log_queues::ring == this->m_monitor.log_queue_config().m_queue) {
+            metric(result, "philosophers_log_queue_depth", "gauge", this->m_monitor.queue_depth());
+        }
+
+        metric(result, "philosophers_log_queue_capacity", "gauge", this->m_monitor.log_queue_config().m_capacity);
+        metric(result, "philosophers_dropped_events_total", "counter", this->m_monitor.dropped());
+        Drain_statistics const drains = this->m_monitor.drain_statistics();
+        metric(result, "philosophers_drains_total", "counter", drains.m_drains);
+        metric(result, "philosophers_drained_events_total", "counter", drains.m_events);
+        metric(result, "philosophers_consumer_wakeups_total", "counter", drains.m_wakeups);
+
+        if (Fan_out_monitor const* const p_fan_out = dynamic_cast<Fan_out_monitor const*>(&this->m_monitor)) {
+            result += "# TYPE philosophers_fan_out_dropped_batches_total counter\n";
+
+            for (std::size_t i = 0; i < p_fan_out->number_of_sinks(); ++i) {
+                result += "philosophers_fan_out_dropped_batches_total{sink=\"" + std::to_string(i) + "\"} "
+                          + std::to_string(p_fan_out->dropped_batches(i)) + "\n";
+            }
+        }
+
+        return result;
+    }
+
+private:
+    static void
+        metric(std::string& _out, char const* _name, char const* _type, std::uint64_t _value)
+    {
+        _out += std::string("# TYPE ") + _name + " " + _type + "\n" + _name + " " + std::to_string(_value) + "\n";
+    }
+
+    /// @brief cumulative buckets at powers of 2 ns from 1 us to 64 s, they are bounds of Histogram buckets
+    static void
+        histogram(std::string& _out, std::string const& _name, Histogram const& _histogram)
+    {
+        _out += "# TYPE " + _name + " histogram\n";
+        std::uint64_t accumulated = 0;
+        unsigned index = 0;
+
+        for (unsigned exponent = 10; exponent <= 36; ++exponent) {
+            std::uint64_t const bound = std::uint64_t(1) << exponent;
+
+            for (; index < Histogram::number_of_buckets && Histogram::upper_bound(index) <= bound; ++index) {
+                accumulated += _histogram.bucket(index);
+            }
+
+            char le[32];
+            std::snprintf(le, sizeof le, "%.9g", double(bound) * 1e-9);
+            _out += _name + "_bucket{le=\"" + le + "\"} " + std::to_string(accumulated) + "\n";
+        }
+
+        // buckets are read one by one, so count is taken as their sum to keep the series consistent
+        for (; index < Histogram::number_of_buckets; ++index) {
+            accumulated += _histogram.bucket(index);
+        }
+
+        char sum[32];
+        std::snprintf(sum, sizeof sum, "%.9g", double(_histogram.sum()) * 1e-9);
+        _out += _name + "_bucket{le=\"+Inf\"} " + std::to_string(accumulated) + "\n"
+                + _name + "_sum " + sum + "\n"
+                + _name + "_count " + std::to_string(accumulated) + "\n";
+    }
+
+    /// @brief accept connections one by one until destruction, stop flag is checked every 100 ms
+    void
+        serve()
+    {
+        while (!this->m_is_stopped.load()) {
+            pollfd listener;
+            listener.fd = this->m_fd;
+            listener.events = POLLIN;
+            listener.revents = 0;
+
+            if (::poll(&listener, 1, 100) <= 0) {
+                continue;
+            }
+
+            int const connection = ::accept(this->m_fd, nullptr, nullptr);
+
+            if (connection < 0) {
+                continue;
+            }
+
+            try {
+                respond(connection);
+            } catch (std::exception const& _excp) {
+                std::cerr << "Catch std::exception in metrics server: " << _excp.what() << std::endl;
+            }
+
+            ::close(connection);
+        }
+    }
+
+    void
+        respond(int _connection)const
+    {
+        std::string request;
+        char buffer[1024];
+
+        // only the request line matters, it is read with 1 s limit
+        while (request.find("\r\n") == std::string::npos && request.size() < 8192) {
+            pollfd client;
+            client.fd = _connection;
+            client.events = POLLIN;
+            client.revents = 0;
+
+            if (::poll(&client, 1, 1000) <= 0) {
+                return;
+            }
+
+            ssize_t const received = ::recv(_connection, buffer, sizeof buffer, 0);
+
+            if (received <= 0) {
+                return;
+            }
+
+            request.append(buffer, std::size_t(received));
+        }
+
+        bool const is_metrics = 0 == request.compare(0, 13, "GET /metrics ") || 0 == request.compare(0, 6, "GET / ");
+        std::string const body = is_metrics ? render() : std::string("Not found\n");
+        std::string const response = std::string(is_metrics ? "HTTP/1.0 200 OK\r\n" : "HTTP/1.0 404 Not Found\r\n")
+                                     + "Content-Type: text/plain; version=0.0.4\r\n"
+                                     + "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                                     + "Connection: close\r\n\r\n"
+                                     + body;
+
+        for (std::size_t sent = 0; sent < response.size();) {
+            ssize_t const result = ::send(_connection, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+
+            if (result <= 0) {
+                return;
+            }
+
+            sent += std::size_t(result);
+        }
+    }
+
+    Monitor const& m_monitor;
+    Statistics_monitor const* const m_p_statistics;
+    int const m_fd;
+    unsigned m_port;
+    std::atomic<bool> m_is_stopped;
+    std::thread m_thread;
+};
+
+/// @brief the monitor itself or the first of its fan-out sinks collecting statistics
+/// @return nullptr if there is none
+inline Statistics_monitor const*
+find_statistics(Monitor const& _monitor)
+{
+    if (Statistics_monitor const* const p_statistics = dynamic_cast<Statistics_monitor const*>(&_monitor)) {
+        return p_statistics;
+    }
+
+    if (Fan_out_monitor const* const p_fan_out = dynamic_cast<Fan_out_monitor const*>(&_monitor)) {
+        for (std::size_t i = 0; i < p_fan_out->number_of_sinks(); ++i) {
+            if (Statistics_monitor const* const p_statistics = dynamic_cast<Statistics_monitor const*>(&p_fan_out->sink(i))) {
+                return p_statistics;
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+}  // namespace philosophers
+
+#endif  // PHILOSOPHERS_METRICS_HPP_
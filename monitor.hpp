@@ -0,0 +1,885 @@
+#ifndef PHILOSOPHERS_MONITOR_HPP_
+#define PHILOSOPHERS_MONITOR_HPP_
+
+#include "philosopher.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace philosophers {
+
+/// @brief bounded lock-free queue for multiple producers and single consumer
+///
+/// Every cell has a sequence number telling whether it is free for the producer of this lap
+/// or filled for the consumer (D. Vyukov's bounded queue). Pop is safe for several threads,
+/// so producers can also drop the oldest elements.
+template<typename Element>
+class Ring_queue
+{
+    struct Cell
+    {
+        std::atomic<std::size_t> m_sequence;
+        Element m_value;
+    };
+
+    /// keep producers and consumer positions in different cache lines
+    static std::size_t const cache_line_size = 64;
+
+public:
+    /// @param _capacity rounded up to power of 2
+    explicit
+        Ring_queue(std::size_t _capacity)
+        : m_mask(round_up_to_power_of_2(_capacity) - 1)
+        , m_cells(new Cell[m_mask + 1])
+        , m_tail(0)
+        , m_head(0)
+    {
+        for (std::size_t i = 0; i <= this->m_mask; ++i) {
+            this->m_cells[i].m_sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    std::size_t
+        capacity()const
+    {
+        return this->m_mask + 1;
+    }
+
+    /// @return false if queue is full
+    bool
+        try_push(Element const& _value)
+    {
+        std::size_t position = this->m_tail.load(std::memory_order_relaxed);
+
+        for (;;) {
+            Cell& cell = this->m_cells[position & this->m_mask];
+            std::size_t const sequence = cell.m_sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t const difference = std::ptrdiff_t(sequence) - std::ptrdiff_t(position);
+
+            if (0 == difference) {
+                if (this->m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    cell.m_value = _value;
+                    cell.m_sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = this->m_tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// @return false if queue is empty
+    bool
+        try_pop(Element& _value)
+    {
+        std::size_t position = this->m_head.load(std::memory_order_relaxed);
+
+        for (;;) {
+            Cell& cell = this->m_cells[position & this->m_mask];
+            std::size_t const sequence = cell.m_sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t const difference = std::ptrdiff_t(sequence) - std::ptrdiff_t(position + 1);
+
+            if (0 == difference) {
+                if (this->m_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    _value = cell.m_value;
+                    cell.m_sequence.store(position + this->m_mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = this->m_head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// @brief pop up to _max consecutive filled elements claimed by one head update
+    /// @return number of popped elements, 0 if queue is empty
+    std::size_t
+        try_pop_bulk(Element* _values, std::size_t _max)
+    {
+        std::size_t position = this->m_head.load(std::memory_order_relaxed);
+
+        for (;;) {
+            std::size_t number = 0;
+
+            while (number < _max && this->m_cells[(position + number) & this->m_mask].m_sequence.load(std::memory_order_acquire) == position + number + 1) {
+                ++number;
+            }
+
+            if (0 == number) {
+                return 0;
+            }
+
+            if (this->m_head.compare_exchange_weak(position, position + number, std::memory_order_relaxed)) {
+                for (std::size_t i = 0; i < number; ++i) {
+                    Cell& cell = this->m_cells[(position + i) & this->m_mask];
+                    _values[i] = cell.m_value;
+                    cell.m_sequence.store(position + i + this->m_mask + 1, std::memory_order_release);
+                }
+
+                return number;
+            }
+        }
+    }
+
+    /// @brief check from consumer side, element being pushed is also taken into account
+    bool
+        empty()const
+    {
+        return this->m_head.load() == this->m_tail.load();
+    }
+
+    /// @brief approximate number of queued elements, could be read from any thread
+    std::size_t
+        size()const
+    {
+        std::size_t const head = this->m_head.load(std::memory_order_relaxed);
+        std::size_t const tail = this->m_tail.load(std::memory_order_relaxed);
+        return tail > head ? std::min(tail - head, this->capacity()) : 0;
+    }
+
+private:
+    static std::size_t
+        round_up_to_power_of_2(std::size_t _value)
+    {
+        std::size_t result = 2;
+
+        while (result < _value) {
+            result <<= 1;
+        }
+
+        return result;
+    }
+
+    std::size_t const m_mask;
+    std::unique_ptr<Cell[]> const m_cells;
+    char m_pad_0[cache_line_size];
+    std::atomic<std::size_t> m_tail;
+    char m_pad_1[cache_line_size - sizeof(std::atomic<std::size_t>)];
+    std::atomic<std::size_t> m_head;
+    char m_pad_2[cache_line_size - sizeof(std::atomic<std::size_t>)];
+};
+
+enum class Log_queues
+{
+    /// vector guarded by mutex
+    mutex,
+    /// bounded lock-free Ring_queue
+    ring
+};
+
+inline char const*
+to_string(Log_queues _queue)
+{
+    switch (_queue) {
+    case Log_queues::mutex:
+        return "mutex";
+
+    case Log_queues::ring:
+        return "ring";
+
+    default:
+        return "?????";
+    }
+}
+
+inline Log_queues
+log_queue_from_string(std::string const& _name)
+{
+    for (auto const queue : {Log_queues::mutex, Log_queues::ring}) {
+        if (_name == to_string(queue)) {
+            return queue;
+        }
+    }
+
+    throw std::invalid_argument("Unknown log queue: " + _name);
+}
+
+/// @brief what producer does when ring is full
+enum class Overflow_policies
+{
+    /// wait until consumer frees space
+    block,
+    /// discard the oldest queued event
+    drop_oldest,
+    /// discard the new event
+    drop
+};
+
+inline char const*
+to_string(Overflow_policies _policy)
+{
+    switch (_policy) {
+    case Overflow_policies::block:
+        return "block";
+
+    case Overflow_policies::drop_oldest:
+        return "drop-oldest";
+
+    case Overflow_policies::drop:
+        return "drop";
+
+    default:
+        return "?????";
+    }
+}
+
+inline Overflow_policies
+overflow_policy_from_string(std::string const& _name)
+{
+    for (auto const policy : {Overflow_policies::block, Overflow_policies::drop_oldest, Overflow_policies::drop}) {
+        if (_name == to_string(policy)) {
+            return policy;
+        }
+    }
+
+    throw std::invalid_argument("Unknown overflow policy: " + _name);
+}
+
+struct Log_queue_config
+{
+    Log_queue_config()
+        : m_queue(Log_queues::ring)
+        , m_overflow_policy(Overflow_policies::block)
+        , m_capacity(1u << 16)
+    {}
+
+    Log_queues m_queue;
+    Overflow_policies m_overflow_policy;
+    /// ring capacity in events
+    unsigned m_capacity;
+};
+
+/// @brief monitor consumer side counters
+struct Drain_statistics
+{
+    Drain_statistics()
+        : m_drains(0)
+        , m_events(0)
+        , m_max_batch(0)
+        , m_wakeups(0)
+        , m_wakeup_latency(0)
+        , m_max_wakeup_latency(0)
+    {}
+
+    std::uint64_t m_drains;
+    std::uint64_t m_events;
+    std::uint64_t m_max_batch;
+    /// number of times consumer was woken by producer
+    std::uint64_t m_wakeups;
+    /// total time between producer notification and consumer resume
+    steady_clock::duration m_wakeup_latency;
+    steady_clock::duration m_max_wakeup_latency;
+};
+
+/// @brief compact state change event, timestamp is taken by the philosopher thread
+///
+/// 16 bytes and trivially copyable, so batches are moved between queues and sinks with memcpy.
+/// Sequence number of the seat keeps its events ordered and reveals lost ones
+/// even when producers race for the queue.
+struct State_log_element
+{
+    State_log_element()
+        : m_time()
+        , m_id(0)
+        , m_sequence(0)
+        , m_state(Philosopher::States::thinks)
+    {}
+
+    State_log_element(Clock::time_point _time, std::uint32_t _id, Philosopher::States _state, std::uint16_t _sequence = 0)
+        : m_time(_time)
+        , m_id(_id)
+        , m_sequence(_sequence)
+        , m_state(_state)
+    {}
+
+    Clock::time_point m_time;
+    std::uint32_t m_id;
+    std::uint16_t m_sequence;
+    Philosopher::States m_state;
+};
+
+static_assert(sizeof(State_log_element) == 16, "State_log_element is expected to be 16 bytes");
+static_assert(std::is_trivially_copyable<State_log_element>::value, "State_log_element is copied in bulk");
+
+/// @brief table layout reported by Canteen to its monitor
+struct Seating
+{
+    Seating()
+        : m_fork_policy(Fork_policies::back_off)
+    {}
+
+    /// @brief seat has forks and was not taken out of a resized ring
+    bool
+        is_seated(unsigned _seat)const
+    {
+        return _seat < this->m_forks.size() && !std::binary_search(this->m_removed_seats.cbegin(), this->m_removed_seats.cend(), _seat);
+    }
+
+    Fork_policies m_fork_policy;
+    /// left and right fork ids of every seat, removed seats keep their last forks for their late events
+    std::vector<std::pair<unsigned, unsigned>> m_forks;
+    /// ascending ids of seats removed from a resized ring
+    std::vector<unsigned> m_removed_seats;
+};
+
+class Monitor
+{
+public:
+    typedef State_log_element state_log_element_type;
+    typedef std::vector<state_log_element_type> log_queue_type;
+
+    explicit
+        Monitor(Log_queue_config const& _config = Log_queue_config())
+        : m_config(_config)
+        , m_ring(Log_queues::ring == _config.m_queue ? _config.m_capacity : 0)
+        , m_is_consumer_waiting(false)
+        , m_is_drained_inline(false)
+        , m_is_stop_requested(false)
+        , m_is_seating_pending(false)
+        , m_p_counters(nullptr)
+        , m_dropped(0)
+        , m_wakeup_request_time(0)
+        , m_drains(0)
+        , m_drained_events(0)
+        , m_max_batch(0)
+        , m_wakeups(0)
+        , m_wakeup_latency(0)
+        , m_max_wakeup_latency(0)
+    {
+        if (Log_queues::mutex == _config.m_queue) {
+            this->m_log_queue.reserve(_config.m_capacity);
+        }
+    }
+
+    virtual
+        ~Monitor()
+    {}
+
+    void
+        log_state(Philosopher const& _philosopher)
+    {
+        state_log_element_type const element(_philosopher.clock().now(), _philosopher.id(), _philosopher.state(), _philosopher.sequence());
+
+        if (Log_queues::ring == this->m_config.m_queue) {
+            push(element);
+            return;
+        }
+
+        bool is_consumer_waiting;
+        {
+            std::lock_guard<decltype(this->m_log_queue_mutex)> locker(this->m_log_queue_mutex);
+            m_log_queue.push_back(element);
+            // consumer checks the flag and the queue under the same mutex
+            is_consumer_waiting = this->m_is_consumer_waiting.exchange(false, std::memory_order_relaxed);
+
+            if (is_consumer_waiting) {
+                request_wakeup();
+            }
+        }
+
+        if (is_consumer_waiting) {
+            this->m_state_logged_event.notify_one();
+        }
+    }
+
+    /// @brief consume events until request_stop()
+    /// @throw std::runtime_error if there are no events for a long time
+    void
+        monitor_worker()
+    {
+        if (Log_queues::ring == this->m_config.m_queue) {
+            ring_worker();
+        } else {
+            mutex_worker();
+        }
+    }
+
+    /// @brief wait for request_stop() without consuming events, used when philosophers are not monitored
+    void
+        wait_for_stop()
+    {
+        std::unique_lock<decltype(this->m_log_queue_mutex)> locker(this->m_log_queue_mutex);
+        this->m_state_logged_event.wait(locker, [this]() {
+            return this->m_is_stop_requested.load();
+        });
+    }
+
+    /// @brief make monitor_worker() return, could be called from any thread
+    void
+        request_stop()
+    {
+        this->m_is_stop_requested.store(true);
+        {
+            std::lock_guard<decltype(this->m_log_queue_mutex)> locker(this->m_log_queue_mutex);
+        }
+        this->m_state_logged_event.notify_all();
+    }
+
+    /// @brief log queued events without waiting, used by single-threaded Simulation
+    void
+        drain()
+    {
+        if (Log_queues::ring == this->m_config.m_queue) {
+            if (pop_all(this->m_drain_log)) {
+                log_drained(this->m_drain_log);
+                this->m_drain_log.clear();
+            } else {
+                apply_pending_seating();
+            }
+
+            return;
+        }
+
+        {
+            std::lock_guard<decltype(this->m_log_queue_mutex)> locker(this->m_log_queue_mutex);
+
+            if (this->m_log_queue.empty()) {
+                apply_pending_seating();
+                return;
+            }
+
+            std::swap(this->m_drain_log, this->m_log_queue);
+        }
+        log_drained(this->m_drain_log);
+        this->m_drain_log.clear();
+    }
+
+    /// @brief log events left in the queue at the end of a run, then write what the monitor held back
+    void
+        finish()
+    {
+        drain();
+        events_finished();
+    }
+
+    /// @brief called by Canteen before philosophers start
+    virtual void
+        set_seating(Seating const&)
+    {}
+
+    /// @brief seating of a running canteen changed, could be called from any thread
+    ///
+    /// The consumer passes it to set_seating() before it logs the next batch of events.
+    void
+        update_seating(Seating const& _seating)
+    {
+        std::lock_guard<std::mutex> lock(this->m_seating_mutex);
+        this->m_p_pending_seating.reset(new Seating(_seating));
+        this->m_is_seating_pending.store(true, std::memory_order_release);
+    }
+
+    /// @brief counters blocks of philosophers, owned by Canteen
+    void
+        attach_counters(Counters_table const* _p_counters)
+    {
+        this->m_p_counters = _p_counters;
+    }
+
+    /// @brief sum of counters of all philosophers, does not stop or lock philosophers
+    Counters_snapshot
+        counters_snapshot()const
+    {
+        Counters_snapshot result;
+
+        if (this->m_p_counters) {
+            for (auto const& counters : *this->m_p_counters) {
+                counters.add_to(result);
+            }
+        }
+
+        return result;
+    }
+
+    /// @brief number of seats with attached counters, 0 - no counters attached
+    std::size_t
+        number_of_counted_seats()const
+    {
+        return this->m_p_counters ? this->m_p_counters->size() : 0;
+    }
+
+    Counters_snapshot
+        counters_snapshot(unsigned _seat)const
+    {
+        Counters_snapshot result;
+
+        if (this->m_p_counters && _seat < this->m_p_counters->size()) {
+            (*this->m_p_counters)[_seat].add_to(result);
+        }
+
+        return result;
+    }
+
+    /// @brief log batch of events from another source (e.g. recorded trace) bypassing the queue
+    void
+        consume(log_queue_type const& _events)
+    {
+        log_drained(_events);
+    }
+
+    /// @brief events are consumed by the producing thread itself (single-threaded Simulation),
+    /// so on full ring queued events are logged instead of waiting for consumer
+    void
+        set_drained_inline(bool _is_drained_inline)
+    {
+        this->m_is_drained_inline = _is_drained_inline;
+    }
+
+    bool
+        is_drained_inline()const
+    {
+        return this->m_is_drained_inline;
+    }
+
+    Log_queue_config const&
+        log_queue_config()const
+    {
+        return this->m_config;
+    }
+
+    /// @brief approximate number of events in ring queue, could be read from any thread without locking
+    /// @return 0 for mutex queue, its size is not read without its mutex
+    std::size_t
+        queue_depth()const
+    {
+        return this->m_ring.size();
+    }
+
+    /// @brief number of events discarded on ring overflow
+    std::uint64_t
+        dropped()const
+    {
+        return this->m_dropped.load(std::memory_order_relaxed);
+    }
+
+    /// @brief snapshot of consumer counters, could be taken from any thread
+    Drain_statistics
+        drain_statistics()const
+    {
+        Drain_statistics result;
+        result.m_drains = this->m_drains.load(std::memory_order_relaxed);
+        result.m_events = this->m_drained_events.load(std::memory_order_relaxed);
+        result.m_max_batch = this->m_max_batch.load(std::memory_order_relaxed);
+        result.m_wakeups = this->m_wakeups.load(std::memory_order_relaxed);
+        result.m_wakeup_latency = steady_clock::duration(this->m_wakeup_latency.load(std::memory_order_relaxed));
+        result.m_max_wakeup_latency = steady_clock::duration(this->m_max_wakeup_latency.load(std::memory_order_relaxed));
+        return result;
+    }
+
+protected:
+    virtual void
+        events_logger(log_queue_type const& work_log) = 0;
+
+    /// @brief no more events of the run, called by finish()
+    virtual void
+        events_finished()
+    {}
+
+    std::mutex mutable m_log_queue_mutex;
+    std::condition_variable m_state_logged_event;
+    log_queue_type m_log_queue;
+
+private:
+    void
+        push(state_log_element_type const& _element)
+    {
+        while (!this->m_ring.try_push(_element)) {
+            switch (this->m_config.m_overflow_policy) {
+            case Overflow_policies::drop: {
+                this->m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            case Overflow_policies::drop_oldest: {
+                state_log_element_type oldest;
+
+                if (this->m_ring.try_pop(oldest)) {
+                    this->m_dropped.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                break;
+            }
+
+            default:
+                if (this->m_is_drained_inline) {
+                    drain();
+                } else if (this->m_is_stop_requested.load(std::memory_order_relaxed)) {
+                    // consumer is gone, nobody makes room for late events of still running producers
+                    this->m_dropped.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                } else {
+                    wake_consumer();
+                    std::this_thread::yield();
+                }
+
+                break;
+            }
+        }
+
+        wake_consumer();
+    }
+
+    /// @brief only the first producer after consumer went to sleep notifies it, the others just push
+    void
+        wake_consumer()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (this->m_is_consumer_waiting.load(std::memory_order_relaxed) && this->m_is_consumer_waiting.exchange(false)) {
+            request_wakeup();
+            {
+                std::lock_guard<decltype(this->m_log_queue_mutex)> locker(this->m_log_queue_mutex);
+            }
+            this->m_state_logged_event.notify_one();
+        }
+    }
+
+    bool
+        pop_all(log_queue_type& _work_log)
+    {
+        static std::size_t const chunk_size = 256;
+        state_log_element_type chunk[chunk_size];
+
+        // bounded batch, so producers blocked on full ring are not starved by a long drain
+        for (std::size_t popped = 0; popped < this->m_ring.capacity();) {
+            std::size_t const number = this->m_ring.try_pop_bulk(chunk, std::min(chunk_size, this->m_ring.capacity() - popped));
+
+            if (0 == number) {
+                break;
+            }
+
+            _work_log.insert(_work_log.end(), chunk, chunk + number);
+            popped += number;
+        }
+
+        return !_work_log.empty();
+    }
+
+    /// @brief called by producer which is going to notify consumer
+    void
+        request_wakeup()
+    {
+        this->m_wakeup_request_time.store(steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    }
+
+    /// @brief called by consumer resumed after wait
+    void
+        account_wakeup()
+    {
+        steady_clock::rep const request_time = this->m_wakeup_request_time.exchange(0, std::memory_order_relaxed);
+
+        if (0 == request_time) {
+            return;
+        }
+
+        steady_clock::rep const latency = steady_clock::now().time_since_epoch().count() - request_time;
+        this->m_wakeups.fetch_add(1, std::memory_order_relaxed);
+        this->m_wakeup_latency.fetch_add(latency, std::memory_order_relaxed);
+
+        if (this->m_max_wakeup_latency.load(std::memory_order_relaxed) < latency) {
+            this->m_max_wakeup_latency.store(latency, std::memory_order_relaxed);
+        }
+    }
+
+    /// @brief events popped after update_seating() are logged with the updated seating
+    void
+        log_drained(log_queue_type const& _events)
+    {
+        apply_pending_seating();
+        account_drain(_events.size());
+        events_logger(_events);
+    }
+
+    /// @brief a single load when seating is not changed
+    void
+        apply_pending_seating()
+    {
+        if (!this->m_is_seating_pending.load(std::memory_order_acquire)) {
+            return;
+        }
+
+        std::unique_ptr<Seating const> p_seating;
+        {
+            std::lock_guard<std::mutex> lock(this->m_seating_mutex);
+            p_seating.swap(this->m_p_pending_seating);
+            this->m_is_seating_pending.store(false, std::memory_order_relaxed);
+        }
+
+        if (p_seating) {
+            set_seating(*p_seating);
+        }
+    }
+
+    /// @note all counters are written by the single consumer
+    void
+        account_drain(std::size_t _batch_size)
+    {
+        this->m_drains.fetch_add(1, std::memory_order_relaxed);
+        this->m_drained_events.fetch_add(_batch_size, std::memory_order_relaxed);
+
+        if (this->m_max_batch.load(std::memory_order_relaxed) < _batch_size) {
+            this->m_max_batch.store(_batch_size, std::memory_order_relaxed);
+        }
+    }
+
+    /// @brief no events for this long means philosophers are stuck, at least 100ms for sub-millisecond intervals
+    static std::chrono::nanoseconds
+        stall_timeout()
+    {
+        return std::max<std::chrono::nanoseconds>(10 * g_max_interval, std::chrono::milliseconds(100));
+    }
+
+    /// @brief double-buffered drain of mutex guarded queue
+    ///
+    /// Consumer swaps its empty work buffer with the producers queue, so both vectors keep their capacity.
+    void
+        mutex_worker()
+    {
+        log_queue_type work_log;
+        work_log.reserve(this->m_config.m_capacity);
+        auto const timeout = stall_timeout();
+
+        while (!this->m_is_stop_requested.load()) {
+            {
+                std::unique_lock<decltype(this->m_log_queue_mutex)> locker(this->m_log_queue_mutex);
+
+                if (this->m_log_queue.empty()) {
+                    this->m_is_consumer_waiting.store(true, std::memory_order_relaxed);
+                    bool const has_events = this->m_state_logged_event.wait_for(locker, timeout, [this]() {
+                        return !this->m_log_queue.empty() || this->m_is_stop_requested.load();
+                    });
+                    this->m_is_consumer_waiting.store(false, std::memory_order_relaxed);
+
+                    if (!has_events) {
+                        throw std::runtime_error("No events for a long time");
+                    }
+
+                    if (this->m_is_stop_requested.load()) {
+                        return;
+                    }
+
+                    account_wakeup();
+                }
+
+                std::swap(work_log, this->m_log_queue);
+            }
+            log_drained(work_log);
+            work_log.clear();
+        }
+    }
+
+    void
+        ring_worker()
+    {
+        log_queue_type work_log;
+        work_log.reserve(this->m_ring.capacity());
+        auto const timeout = stall_timeout();
+
+        while (!this->m_is_stop_requested.load()) {
+            if (pop_all(work_log)) {
+                log_drained(work_log);
+                work_log.clear();
+                continue;
+            }
+
+            std::unique_lock<decltype(this->m_log_queue_mutex)> locker(this->m_log_queue_mutex);
+            // flag is set before every sleep: producer of an event drained meanwhile could take it, notify and leave the ring empty
+            bool const has_events = this->m_state_logged_event.wait_for(locker, timeout, [this]() {
+                this->m_is_consumer_waiting.store(true);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                return !this->m_ring.empty() || this->m_is_stop_requested.load();
+            });
+            this->m_is_consumer_waiting.store(false);
+
+            if (!has_events) {
+                throw std::runtime_error("No events for a long time");
+            }
+
+            account_wakeup();
+        }
+    }
+
+    Log_queue_config const m_config;
+    Ring_queue<state_log_element_type> m_ring;
+    std::atomic<bool> m_is_consumer_waiting;
+    bool m_is_drained_inline;
+    std::atomic<bool> m_is_stop_requested;
+    std::mutex m_seating_mutex;
+    std::unique_ptr<Seating const> m_p_pending_seating;
+    std::atomic<bool> m_is_seating_pending;
+    Counters_table const* m_p_counters;
+    std::atomic<std::uint64_t> m_dropped;
+    log_queue_type m_drain_log;
+
+    std::atomic<steady_clock::rep> m_wakeup_request_time;
+    std::atomic<std::uint64_t> m_drains;
+    std::atomic<std::uint64_t> m_drained_events;
+    std::atomic<std::uint64_t> m_max_batch;
+    std::atomic<std::uint64_t> m_wakeups;
+    std::atomic<steady_clock::rep> m_wakeup_latency;
+    std::atomic<steady_clock::rep> m_max_wakeup_latency;
+};
+
+/// @brief sink of Basic_philosopher reporting every state change to Monitor
+class Monitor_sink
+{
+public:
+    static bool const is_monitored = true;
+
+    explicit
+        Monitor_sink(Monitor& _monitor)
+        : m_p_monitor(&_monitor)
+    {}
+
+    void
+        log(Philosopher const& _philosopher)const
+    {
+        this->m_p_monitor->log_state(_philosopher);
+    }
+
+private:
+    Monitor* m_p_monitor;
+};
+
+/// @brief sink of Basic_philosopher without reporting, monitor is used only to stop the canteen
+class Null_sink
+{
+public:
+    static bool const is_monitored = false;
+
+    explicit
+        Null_sink(Monitor&)
+    {}
+
+    void
+        log(Philosopher const&)const
+    {}
+};
+
+/// @brief monitor of canteen with Null_sink, it only stops the run
+class Null_monitor
+    : public Monitor
+{
+protected:
+    void
+        events_logger(log_queue_type const&)override
+    {}
+};
+
+}  // namespace philosophers
+
+#endif  // PHILOSOPHERS_MONITOR_HPP_
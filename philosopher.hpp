@@ -0,0 +1,1070 @@
+#ifndef PHILOSOPHERS_PHILOSOPHER_HPP_
+#define PHILOSOPHERS_PHILOSOPHER_HPP_
+
+#include "counters.hpp"
+#include "fork.hpp"
+#include "workload.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace philosophers {
+
+using std::chrono::steady_clock;
+
+/// @brief source of time for philosophers
+class Clock
+{
+public:
+    typedef steady_clock::time_point time_point;
+
+    virtual
+        ~Clock()
+    {}
+
+    virtual time_point
+        now()const = 0;
+};
+
+class Steady_clock
+    : public Clock
+{
+public:
+    time_point
+        now()const override
+    {
+        return steady_clock::now();
+    }
+};
+
+/// @brief simulated time, advanced by Simulation only
+class Virtual_clock
+    : public Clock
+{
+public:
+    Virtual_clock()
+        : m_now()
+    {}
+
+    time_point
+        now()const override
+    {
+        return m_now;
+    }
+
+    void
+        advance_to(time_point _time)
+    {
+        this->m_now = _time;
+    }
+
+private:
+    time_point m_now;
+};
+
+/// @brief defaults of fork policies
+///
+/// Policies are not virtual: Basic_philosopher is instantiated for a concrete policy and calls it directly,
+/// so every policy provides aquire(), try_aquire() and release() templates on philosopher type:
+/// - `bool aquire(Philosopher&)` block until philosopher gets both forks,
+///   false if waiting is cancelled (philosopher is killed or starving), no forks are held then
+/// - `bool try_aquire(Philosopher&)` non-blocking variant of aquire(), false if philosopher still waits for forks
+/// - `void release(Philosopher&)` return both forks taken by aquire()
+class Fork_policy
+{
+public:
+    /// @brief philosopher is dead or killed and does not eat anymore
+    template<typename Philosopher_type>
+    void
+        leave(Philosopher_type&)
+    {}
+
+    /// @brief wake philosophers blocked in aquire() by policy own waits to check their stop tokens
+    void
+        interrupt()
+    {}
+
+    /// @brief seats could be added to and removed from a running ring, the policy keeps no per-seat state
+    static bool const is_ring_resizable = false;
+
+    /// @brief philosophers could take fork sets of any Topology, see Philosopher::forks()
+    static bool const is_fork_set_supported = false;
+};
+
+/// @brief philosopher dies if it does not eat for m_death_threshold maximal intervals
+class Starvation
+{
+public:
+    static bool const is_enabled = true;
+
+    explicit
+        Starvation(Clock const& _clock)
+        : m_last_eating(_clock.now())
+    {}
+
+    void
+        ate(Clock const& _clock)
+    {
+        this->m_last_eating = _clock.now();
+    }
+
+    /// @brief remaining time until philosopher starves to death
+    std::chrono::nanoseconds
+        time_to_death(Clock const& _clock)const
+    {
+        return deadline() - _clock.now();
+    }
+
+    /// @brief time point of death derived from the last meal
+    Clock::time_point
+        deadline()const
+    {
+        return this->m_last_eating + death_interval();
+    }
+
+    /// @brief philosopher dies if it does not eat for this long
+    static std::chrono::nanoseconds
+        death_interval()
+    {
+        return unsigned(m_death_threshold) * g_max_interval;
+    }
+
+private:
+    Clock::time_point m_last_eating;
+    static unsigned const m_death_threshold = 4;
+};
+
+/// @brief philosopher never dies, clock is not even read
+class No_starvation
+{
+public:
+    static bool const is_enabled = false;
+
+    explicit
+        No_starvation(Clock const&)
+    {}
+
+    void
+        ate(Clock const&)
+    {}
+
+    std::chrono::nanoseconds
+        time_to_death(Clock const&)const
+    {
+        return std::chrono::nanoseconds::max();
+    }
+
+    Clock::time_point
+        deadline()const
+    {
+        return Clock::time_point::max();
+    }
+};
+
+enum class Fork_policies
+{
+    back_off,
+    ordered,
+    waiter,
+    chandy_misra
+};
+
+inline char const*
+to_string(Fork_policies _policy)
+{
+    switch (_policy) {
+    case Fork_policies::back_off:
+        return "back-off";
+
+    case Fork_policies::ordered:
+        return "ordered";
+
+    case Fork_policies::waiter:
+        return "waiter";
+
+    case Fork_policies::chandy_misra:
+        return "chandy-misra";
+
+    default:
+        return "?????";
+    }
+}
+
+inline Fork_policies
+fork_policy_from_string(std::string const& _name)
+{
+    for (auto const policy : {Fork_policies::back_off, Fork_policies::ordered, Fork_policies::waiter, Fork_policies::chandy_misra}) {
+        if (_name == to_string(policy)) {
+            return policy;
+        }
+    }
+
+    throw std::invalid_argument("Unknown fork policy: " + _name);
+}
+
+/// @brief resolution of random thinking and eating intervals
+enum class Interval_units
+{
+    ms,
+    us,
+    ns
+};
+
+inline char const*
+to_string(Interval_units _unit)
+{
+    switch (_unit) {
+    case Interval_units::ms:
+        return "ms";
+
+    case Interval_units::us:
+        return "us";
+
+    case Interval_units::ns:
+        return "ns";
+
+    default:
+        return "?????";
+    }
+}
+
+inline Interval_units
+interval_unit_from_string(std::string const& _name)
+{
+    for (auto const unit : {Interval_units::ms, Interval_units::us, Interval_units::ns}) {
+        if (_name == to_string(unit)) {
+            return unit;
+        }
+    }
+
+    throw std::invalid_argument("Unknown interval unit: " + _name);
+}
+
+inline std::chrono::nanoseconds
+duration_of(Interval_units _unit)
+{
+    return Interval_units::ms == _unit ? std::chrono::nanoseconds(std::chrono::milliseconds(1))
+           : Interval_units::us == _unit ? std::chrono::nanoseconds(std::chrono::microseconds(1))
+           : std::chrono::nanoseconds(1);
+}
+
+/// @brief how philosophers spend thinking and eating intervals
+enum class Work_modes
+{
+    /// block on timed wait, thread is free for others
+    sleep,
+    /// busy-wait with CPU pause hint, saturates cores to stress the fork primitives
+    spin
+};
+
+inline char const*
+to_string(Work_modes _work)
+{
+    switch (_work) {
+    case Work_modes::sleep:
+        return "sleep";
+
+    case Work_modes::spin:
+        return "spin";
+
+    default:
+        return "?????";
+    }
+}
+
+inline Work_modes
+work_mode_from_string(std::string const& _name)
+{
+    for (auto const work : {Work_modes::sleep, Work_modes::spin}) {
+        if (_name == to_string(work)) {
+            return work;
+        }
+    }
+
+    throw std::invalid_argument("Unknown work mode: " + _name);
+}
+
+/// @brief set g_max_interval, g_interval_unit and g_is_spin_work of the run
+inline void
+set_intervals(unsigned _max_interval, Interval_units _unit, Work_modes _work)
+{
+    g_interval_unit = duration_of(_unit);
+    g_max_interval = std::max(1u, _max_interval) * g_interval_unit;
+    g_is_spin_work = Work_modes::spin == _work;
+}
+
+/// @brief recorded intervals and dining order replayed by philosophers of a Simulation
+///
+/// Every seat draws its thinking and dining intervals from the script instead of its random generator
+/// and dines only in its turn at both forks, so forks are acquired in the recorded order.
+/// Seats run freely when their recorded events are exhausted. Not thread-safe, used by single-threaded Simulation only.
+class Schedule_script
+{
+public:
+    /// @param _forks left and right fork ids of every seat
+    explicit
+        Schedule_script(std::vector<std::pair<unsigned, unsigned>> const& _forks)
+        : m_forks(_forks)
+        , m_intervals(_forks.size())
+    {
+        for (auto const& forks : _forks) {
+            this->m_turns.resize(std::max<std::size_t>(this->m_turns.size(), std::max(forks.first, forks.second) + 1));
+        }
+    }
+
+    std::size_t
+        number_of_seats()const
+    {
+        return this->m_forks.size();
+    }
+
+    /// @brief append the next thinking or dining interval of the seat
+    void
+        add_interval(unsigned _seat, std::chrono::nanoseconds _interval)
+    {
+        this->m_intervals[_seat].push_back(std::max(std::chrono::nanoseconds(0), _interval));
+    }
+
+    /// @brief append the next meal of the seat to turns of its forks
+    void
+        add_meal(unsigned _seat)
+    {
+        this->m_turns[this->m_forks[_seat].first].push_back(_seat);
+        this->m_turns[this->m_forks[_seat].second].push_back(_seat);
+    }
+
+    /// @return false if recorded intervals of the seat are exhausted
+    bool
+        next_interval(unsigned _seat, std::chrono::nanoseconds& _interval)
+    {
+        std::deque<std::chrono::nanoseconds>& intervals = this->m_intervals[_seat];
+
+        if (intervals.empty()) {
+            return false;
+        }
+
+        _interval = intervals.front();
+        intervals.pop_front();
+        return true;
+    }
+
+    /// @brief the seat is the next recorded diner at both forks or their recorded turns are exhausted
+    bool
+        is_turn(unsigned _seat)const
+    {
+        return is_turn(this->m_forks[_seat].first, _seat) && is_turn(this->m_forks[_seat].second, _seat);
+    }
+
+    /// @brief the seat started its meal, next diners get their turns at its forks
+    void
+        dined(unsigned _seat)
+    {
+        pass_turn(this->m_forks[_seat].first, _seat);
+        pass_turn(this->m_forks[_seat].second, _seat);
+    }
+
+private:
+    bool
+        is_turn(unsigned _fork, unsigned _seat)const
+    {
+        return this->m_turns[_fork].empty() || this->m_turns[_fork].front() == _seat;
+    }
+
+    void
+        pass_turn(unsigned _fork, unsigned _seat)
+    {
+        if (!this->m_turns[_fork].empty() && this->m_turns[_fork].front() == _seat) {
+            this->m_turns[_fork].pop_front();
+        }
+    }
+
+    std::vector<std::pair<unsigned, unsigned>> m_forks;
+    /// thinking and dining intervals of every seat in order they are drawn
+    std::vector<std::deque<std::chrono::nanoseconds>> m_intervals;
+    /// seats in order of their meals at every fork
+    std::vector<std::deque<unsigned>> m_turns;
+};
+
+/// @brief forks of a seat in ascending id order, owned by Canteen
+class Fork_range
+{
+public:
+    Fork_range(Fork* const* _p_begin, Fork* const* _p_end)
+        : m_p_begin(_p_begin)
+        , m_p_end(_p_end)
+    {}
+
+    Fork* const*
+        begin()const
+    {
+        return this->m_p_begin;
+    }
+
+    Fork* const*
+        end()const
+    {
+        return this->m_p_end;
+    }
+
+    std::size_t
+        size()const
+    {
+        return std::size_t(this->m_p_end - this->m_p_begin);
+    }
+
+    Fork&
+        operator[](std::size_t _index)const
+    {
+        return *this->m_p_begin[_index];
+    }
+
+private:
+    Fork* const* m_p_begin;
+    Fork* const* m_p_end;
+};
+
+/// @brief state, forks and resources of philosopher shared by all instantiations of Basic_philosopher
+///
+/// Monitors, Scheduler bookkeeping and fork policies read philosophers through this class, without virtual calls.
+class Philosopher
+{
+public:
+    /// @brief one byte, so packed events stay small
+    enum class States : std::uint8_t
+    {
+        thinks,
+        hungry,
+        dines,
+        /// starved to death, only if starvation is enabled, killed philosopher keeps its last state
+        dead
+    };
+
+    /// @brief result of one non-blocking step of philosopher state machine
+    struct Step
+    {
+        enum Kinds
+        {
+            sleep,   ///< resume after m_interval
+            park,    ///< wait for forks, resume when neighbour releases forks or after m_interval (starvation check), max - no deadline
+            finished ///< philosopher is dead or killed
+        };
+
+        Step(Kinds _kind, std::chrono::nanoseconds _interval = std::chrono::nanoseconds(0), bool _is_forks_released = false)
+            : m_kind(_kind)
+            , m_interval(_interval)
+            , m_is_forks_released(_is_forks_released)
+        {}
+
+        Kinds m_kind;
+        std::chrono::nanoseconds m_interval;
+        bool m_is_forks_released;
+    };
+
+    /// @param _id seat at the table, used by fork policies
+    /// @param _seat banquet-wide seat, seeds random generator, so tables of a Banquet differ
+    Philosopher(unsigned _id, unsigned _seat, Fork& _left, Fork& _right, Clock const& _clock, Philosopher_counters& _counters)
+        : m_id(_id)
+        , m_state(States::thinks)
+        , m_sequence(0)
+        , m_p_left_fork(&_left)
+        , m_p_right_fork(&_right)
+        , m_forks(nullptr, nullptr)
+        , m_is_pause_requested(false)
+        , m_is_quiescent(false)
+        , m_random_engine(seed(_seat))
+        , m_eating_factor(1.)
+        , m_clock(_clock)
+        , m_counters(_counters)
+        , m_p_script(nullptr)
+#ifdef PHILOSOPHERS_COUNTERS
+        , m_state_since(_clock.now())
+#endif
+    {}
+
+    Philosopher(Philosopher const&) = delete;
+    Philosopher& operator=(Philosopher const&) = delete;
+
+    /// @brief cooperative cancellation, wakes the philosopher if it sleeps
+    ///
+    /// Fork waits are woken by Fork::interrupt() and interrupt() of fork policy by owner of forks and policy.
+    void
+        kill()
+    {
+        this->m_stop_token.request_stop();
+        {
+            std::lock_guard<std::mutex> lock(this->m_sleep_mutex);
+        }
+        this->m_sleep_event.notify_all();
+    }
+
+    bool
+        is_stop_requested()const
+    {
+        return this->m_stop_token.stop_requested();
+    }
+
+    unsigned
+        id()const
+    {
+        return m_id;
+    }
+
+    States
+        state()const
+    {
+        return m_state;
+    }
+
+    /// @brief number of state changes modulo 2^16, orders events of the seat
+    std::uint16_t
+        sequence()const
+    {
+        return m_sequence;
+    }
+
+    Fork&
+        left_fork()const
+    {
+        return *m_p_left_fork;
+    }
+
+    Fork&
+        right_fork()const
+    {
+        return *m_p_right_fork;
+    }
+
+    /// @brief philosopher of a topology other than ring takes a set of forks instead of left and right ones
+    bool
+        has_fork_set()const
+    {
+        return nullptr != this->m_forks.begin();
+    }
+
+    /// @brief forks of topology seat, empty for the ring
+    Fork_range const&
+        forks()const
+    {
+        return this->m_forks;
+    }
+
+    /// @brief take _forks instead of left and right ones, left and right are the first and the last of the set
+    /// @pre thread of philosopher is not started
+    void
+        set_forks(Fork_range const& _forks)
+    {
+        this->m_forks = _forks;
+        this->m_p_left_fork = &_forks[0];
+        this->m_p_right_fork = &_forks[_forks.size() - 1];
+    }
+
+    /// @brief rewire right fork when the ring is resized
+    /// @pre thread of philosopher is not started, finished or paused, see wait_until_paused()
+    void
+        set_right_fork(Fork& _fork)
+    {
+        this->m_p_right_fork = &_fork;
+    }
+
+    /// @brief ask philosopher to stop before its next thinking, when it holds no forks
+    void
+        request_pause()
+    {
+        this->m_is_pause_requested.store(true, std::memory_order_release);
+    }
+
+    /// @brief wait until philosopher is paused or finished
+    /// @return false if stop was requested meanwhile
+    bool
+        wait_until_paused()
+    {
+        std::unique_lock<std::mutex> lock(this->m_sleep_mutex);
+        this->m_sleep_event.wait(lock, [this]() {
+            return this->m_is_quiescent || this->is_stop_requested();
+        });
+        return this->m_is_quiescent;
+    }
+
+    /// @brief let paused philosopher continue thinking
+    void
+        resume()
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->m_sleep_mutex);
+            this->m_is_pause_requested.store(false, std::memory_order_relaxed);
+        }
+        this->m_sleep_event.notify_all();
+    }
+
+    Clock const&
+        clock()const
+    {
+        return m_clock;
+    }
+
+    Philosopher_counters&
+        counters()
+    {
+        return m_counters;
+    }
+
+    /// @brief busy-wait "work" burning CPU for _interval, interrupted by kill()
+    /// @return false if killed
+    bool
+        spin_for(std::chrono::nanoseconds _interval)
+    {
+        Clock::time_point const end = this->m_clock.now() + _interval;
+
+        while (!is_stop_requested()) {
+            if (this->m_clock.now() >= end) {
+                return true;
+            }
+
+            cpu_relax();
+        }
+
+        return false;
+    }
+
+    /// @brief replay recorded schedule instead of random intervals, owned by Canteen, nullptr - no script
+    void
+        set_script(Schedule_script* _p_script)
+    {
+        this->m_p_script = _p_script;
+    }
+
+    /// @brief workload of banquet-wide _seat, profiles are copied, so sampling touches only the philosopher
+    void
+        set_workload(Workload const& _workload, unsigned _seat)
+    {
+        this->m_thinking = _workload.m_thinking;
+        this->m_eating = _workload.m_eating;
+        this->m_eating_factor = _workload.eating_factor(_seat);
+    }
+
+    /// @brief Fork::try_to_get() for fork policies, failures are counted
+    bool
+        try_to_get(Fork& _fork)
+    {
+        if (_fork.try_to_get()) {
+            return true;
+        }
+
+        this->m_counters.add(Counters::try_failures);
+        return false;
+    }
+
+protected:
+    /// @brief spin then park in Fork::wait_until_available(), timeouts are counted
+    /// @return false on deadline or stop request
+    bool
+        wait_until_available(Fork& _fork, Clock::time_point _deadline)
+    {
+        if (spin_until_available(_fork, _deadline)) {
+            this->m_counters.add(Counters::spin_acquisitions);
+            return true;
+        }
+
+        if (_fork.wait_until_available(_deadline, this->m_stop_token)) {
+            return true;
+        }
+
+        this->m_counters.add(Counters::wait_timeouts);
+        return false;
+    }
+
+    /// @brief retry the fork for about two of its mean hold times if they are shorter than g_spin_limit_us
+    ///
+    /// Short holds are cheaper to wait out on CPU than by park and wakeup, long ones are not worth burning CPU.
+    bool
+        spin_until_available(Fork& _fork, Clock::time_point _deadline)
+    {
+        std::chrono::nanoseconds const hold_time = _fork.mean_hold_time();
+
+        if (0 == g_spin_limit_us || hold_time >= std::chrono::microseconds(g_spin_limit_us)) {
+            return false;
+        }
+
+        Clock::time_point const end = std::min(_deadline, this->m_clock.now() + 2 * hold_time);
+
+        do {
+            if (_fork.try_to_get()) {
+                return true;
+            }
+
+            cpu_relax();
+        } while (!is_stop_requested() && this->m_clock.now() < end);
+
+        return false;
+    }
+
+    /// @brief change state, time spent in previous state is counted
+    void
+        set_state(States _state)
+    {
+#ifdef PHILOSOPHERS_COUNTERS
+        Clock::time_point const now = this->m_clock.now();
+        std::uint64_t const time_in_state = std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(now - this->m_state_since).count());
+        this->m_state_since = now;
+
+        switch (this->m_state) {
+        case States::thinks:
+            this->m_counters.add(Counters::thinking_ns, time_in_state);
+            break;
+
+        case States::hungry:
+            this->m_counters.add(Counters::hungry_ns, time_in_state);
+            break;
+
+        case States::dines:
+            this->m_counters.add(Counters::dining_ns, time_in_state);
+            break;
+
+        default:
+            break;
+        }
+
+#endif
+        ++this->m_sequence;
+        this->m_state = _state;
+    }
+
+    /// @brief sleep interrupted by kill(), or spin_for() in spin work mode
+    /// @return false if killed
+    bool
+        sleep_for(std::chrono::nanoseconds _interval)
+    {
+        if (g_is_spin_work) {
+            return spin_for(_interval);
+        }
+
+        std::unique_lock<std::mutex> lock(this->m_sleep_mutex);
+        return !this->m_sleep_event.wait_for(lock, _interval, [this]() {
+            return this->is_stop_requested();
+        });
+    }
+
+    /// @brief stay here while pause is requested, the check is a single load when it is not
+    /// @return false if killed
+    bool
+        pause_point()
+    {
+        if (!this->m_is_pause_requested.load(std::memory_order_acquire)) {
+            return true;
+        }
+
+        std::unique_lock<std::mutex> lock(this->m_sleep_mutex);
+        this->m_is_quiescent = true;
+        this->m_sleep_event.notify_all();
+        this->m_sleep_event.wait(lock, [this]() {
+            return !this->m_is_pause_requested.load(std::memory_order_relaxed) || this->is_stop_requested();
+        });
+        this->m_is_quiescent = false;
+        return !this->is_stop_requested();
+    }
+
+    /// @brief thread of philosopher ends, it holds no forks anymore
+    void
+        finish()
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->m_sleep_mutex);
+            this->m_is_quiescent = true;
+        }
+        this->m_sleep_event.notify_all();
+    }
+
+    /// @brief philosopher has no script or it is its turn at both forks
+    bool
+        is_turn_to_dine()const
+    {
+        return !this->m_p_script || this->m_p_script->is_turn(this->m_id);
+    }
+
+    /// @brief called when philosopher starts dining, passes turns of its forks to the next diners
+    void
+        take_turn()
+    {
+        if (this->m_p_script) {
+            this->m_p_script->dined(this->m_id);
+        }
+    }
+
+    /// @brief next interval of script, or random one of thinking profile
+    std::chrono::nanoseconds
+        thinking_interval()
+    {
+        return random_interval(this->m_thinking, 1.);
+    }
+
+    /// @brief next interval of script, or random one of eating profile
+    std::chrono::nanoseconds
+        eating_interval()
+    {
+        return random_interval(this->m_eating, this->m_eating_factor);
+    }
+
+private:
+    std::chrono::nanoseconds
+        random_interval(Interval_profile const& _profile, double _factor)
+    {
+        std::chrono::nanoseconds scripted;
+
+        if (this->m_p_script && this->m_p_script->next_interval(this->m_id, scripted)) {
+            return scripted;
+        }
+
+        return _profile.sample(this->m_random_engine, _factor);
+    }
+
+    /// @brief deterministic per-philosopher seed derived from base seed
+    static std::default_random_engine::result_type
+        seed(unsigned _id)
+    {
+        std::seed_seq sequence{g_seed, _id};
+        std::uint32_t value;
+        sequence.generate(&value, &value + 1);
+        return value;
+    }
+
+    unsigned m_id;
+    States m_state;
+    std::uint16_t m_sequence;
+    /// owned by Canteen, which outlives philosophers
+    Fork* m_p_left_fork;
+    Fork* m_p_right_fork;
+    /// empty for the ring
+    Fork_range m_forks;
+    Stop_token m_stop_token;
+    std::atomic<bool> m_is_pause_requested;
+    /// paused or finished, guarded by m_sleep_mutex
+    bool m_is_quiescent;
+    /// also wakes waits for pause
+    std::mutex m_sleep_mutex;
+    std::condition_variable m_sleep_event;
+    /// @brief owned by philosopher thread only, so no locking is required
+    std::default_random_engine m_random_engine;
+    Interval_profile m_thinking;
+    Interval_profile m_eating;
+    /// hot seats eat longer
+    double m_eating_factor;
+    Clock const& m_clock;
+    Philosopher_counters& m_counters;
+    Schedule_script* m_p_script;
+#ifdef PHILOSOPHERS_COUNTERS
+    Clock::time_point m_state_since;
+#endif
+};
+
+/// @brief philosopher specialized at compile time for its fork policy, starvation and events sink
+///
+/// @tparam Policy fork policy (see Fork_policy), called directly
+/// @tparam Starvation_policy Starvation or No_starvation, without starvation deadlines are compiled out
+/// @tparam Sink receiver of state changes with `void log(Philosopher const&)`, e.g. Monitor_sink or Null_sink
+template<typename Policy, typename Starvation_policy, typename Sink>
+class Basic_philosopher
+    : public Philosopher
+{
+public:
+    typedef Policy policy_type;
+
+    Basic_philosopher(unsigned _id, unsigned _seat, Fork& _left, Fork& _right, Policy& _policy, Clock const& _clock, Philosopher_counters& _counters, Sink const& _sink)
+        : Philosopher(_id, _seat, _left, _right, _clock, _counters)
+        , m_policy(_policy)
+        , m_starvation(_clock)
+        , m_sink(_sink)
+    {}
+
+    void
+        operator()()
+    {
+        try {
+            while (thinking() && aquire_forks() && eating()) {
+            }
+
+            die();
+        } catch (...) {
+            std::cerr << "Catch unhandled exception in philosopher id=" << id() << std::endl;
+        }
+
+        this->finish();
+    }
+
+    /// @brief begin resumable state machine, used instead of operator() by cooperative scheduler
+    Step
+        start()
+    {
+        state(States::thinks);
+        return Step(Step::sleep, thinking_interval());
+    }
+
+    /// @brief advance resumable state machine without blocking
+    Step
+        step()
+    {
+        if (this->is_stop_requested()) {
+            return die();
+        }
+
+        switch (this->state()) {
+        case States::thinks:
+            state(States::hungry);
+            return try_to_dine();
+
+        case States::hungry:
+            return try_to_dine();
+
+        case States::dines:
+            this->m_policy.release(*this);
+            this->counters().add(Counters::meals);
+            this->m_starvation.ate(this->clock());
+            state(States::thinks);
+            return Step(Step::sleep, thinking_interval(), true);
+
+        default:
+            return Step(Step::finished);
+        }
+    }
+
+    /// common thread worker
+    static void
+        worker(Basic_philosopher* _p_philosopfer)
+    {
+        (*_p_philosopfer)();
+    }
+
+    using Philosopher::state;
+
+    /// @brief Fork::wait_until_available() for fork policies, timeouts are counted
+    /// @return false on deadline or stop request
+    bool
+        wait_until_available(Fork& _fork)
+    {
+        return Philosopher::wait_until_available(_fork, wait_deadline());
+    }
+
+    /// @brief blocking fork waits of policies end at deadline to check for is_waiting_cancelled()
+    /// @return g_max_interval from now or a unit after death if it is sooner, so starving philosopher wakes in time
+    Clock::time_point
+        wait_deadline()const
+    {
+        Clock::time_point const next_check = this->clock().now() + g_max_interval;
+
+        if (!Starvation_policy::is_enabled) {
+            return next_check;
+        }
+
+        return std::min(next_check, this->m_starvation.deadline() + g_interval_unit);
+    }
+
+    /// @brief philosopher waiting for forks gives up: it is killed or starving
+    bool
+        is_waiting_cancelled()const
+    {
+        return is_stop_requested() || is_starving();
+    }
+
+private:
+    bool
+        is_starving()const
+    {
+        return Starvation_policy::is_enabled && this->m_starvation.time_to_death(this->clock()) < std::chrono::nanoseconds(0);
+    }
+
+    Step
+        try_to_dine()
+    {
+        // out of turn philosopher waits for release of its forks as if they were taken
+        if (this->is_turn_to_dine() && this->m_policy.try_aquire(*this)) {
+            this->take_turn();
+            state(States::dines);
+            return Step(Step::sleep, eating_interval());
+        }
+
+        if (!Starvation_policy::is_enabled) {
+            return Step(Step::park, std::chrono::nanoseconds::max());
+        }
+
+        std::chrono::nanoseconds const time_to_death = this->m_starvation.time_to_death(this->clock());
+
+        if (time_to_death < std::chrono::nanoseconds(0)) {
+            return die();
+        }
+
+        // resume a unit after deadline, when philosopher is definitely starving
+        return Step(Step::park, time_to_death + g_interval_unit);
+    }
+
+    Step
+        die()
+    {
+        this->m_policy.leave(*this);
+
+        // killed philosopher just stops, only starvation is reported as death
+        if (is_starving()) {
+            state(States::dead);
+        }
+
+        return Step(Step::finished);
+    }
+
+    /// @return false if killed
+    bool
+        thinking()
+    {
+        if (!this->pause_point()) {
+            return false;
+        }
+
+        state(States::thinks);
+        return sleep_for(thinking_interval());
+    }
+
+    /// @return false if killed or starving
+    bool
+        aquire_forks()
+    {
+        state(States::hungry);
+        return this->m_policy.aquire(*this);
+    }
+
+    /// @return false if killed, forks are released anyway
+    bool
+        eating()
+    {
+        state(States::dines);
+        bool const is_awake = sleep_for(eating_interval());
+        this->m_policy.release(*this);
+        this->counters().add(Counters::meals);
+        this->m_starvation.ate(this->clock());
+        return is_awake;
+    }
+
+    void
+        state(States _state)
+    {
+        this->set_state(_state);
+        this->m_sink.log(*this);
+    }
+
+    Policy& m_policy;
+    Starvation_policy m_starvation;
+    Sink m_sink;
+};
+
+}  // namespace philosophers
+
+#endif  // PHILOSOPHERS_PHILOSOPHER_HPP_
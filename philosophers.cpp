@@ -1,501 +1,612 @@
-#include <iomanip>
+#include "banquet.hpp"
+#include "canteen.hpp"
+#include "fan_out.hpp"
+#include "metrics.hpp"
+#include "statistics.hpp"
+#include "text_monitors.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <random>
-#include <chrono>
-#include <algorithm>
-#include <condition_variable>
-#include <thread>
-#include <iterator>
+#include <stdexcept>
 #include <string>
-#include <cstdint>
-#include <atomic>
+#include <thread>
+#include <vector>
 
-namespace {
-unsigned g_max_interval_ms = 10000;
-}
 namespace philosophers {
 
-class Fork
+enum class Monitors
 {
-public:
-    Fork(unsigned _id)
-        : m_id(_id)
-        , m_is_available(true)
-    {}
-
-    unsigned
-        id() const
-    {
-        return m_id;
-    }
-
-    bool
-        try_to_get()
-    {
-        std::unique_lock<std::mutex> lock(m_mutex);
-
-        if (this->m_is_available) {
-            this->m_is_available = false;
-            return true;
-        }
+    waterfall,
+    log,
+    trace,
+    /// periodic summary of online statistics
+    stats,
+    /// philosophers are not monitored at all
+    none
+};
 
-        return false;
-    }
+inline char const*
+to_string(Monitors _monitor)
+{
+    switch (_monitor) {
+    case Monitors::waterfall:
+        return "waterfall";
 
-    bool
-        wait_until_available()
-    {
-        std::unique_lock<std::mutex> lock(m_mutex);
+    case Monitors::log:
+        return "log";
 
-        if (this->m_is_available) {
-            this->m_is_available = false;
-            return true;
-        }
+    case Monitors::trace:
+        return "trace";
 
-        using namespace std::chrono;
-        this->m_conditional_variable.wait_for(lock, milliseconds(g_max_interval_ms));
+    case Monitors::stats:
+        return "stats";
 
-        if (this->m_is_available) {
-            this->m_is_available = false;
-            return true;
-        }
+    case Monitors::none:
+        return "none";
 
-        return false;
+    default:
+        return "?????";
     }
+}
 
-    void
-        free()
-    {
-        std::unique_lock<std::mutex> lock(m_mutex);
-        this->m_is_available = true;
-        this->m_conditional_variable.notify_one();
+inline Monitors
+monitor_from_string(std::string const& _name)
+{
+    for (auto const monitor : {Monitors::waterfall, Monitors::log, Monitors::trace, Monitors::stats, Monitors::none}) {
+        if (_name == to_string(monitor)) {
+            return monitor;
+        }
     }
 
-private:
-    unsigned m_id;
-    bool volatile m_is_available;
-    std::mutex m_mutex;
-    std::condition_variable m_conditional_variable;
-};
-
-using std::chrono::steady_clock;
-
-class Monitor;
+    throw std::invalid_argument("Unknown monitor: " + _name);
+}
 
-class Philosopher
+/// @brief `on` or `off`
+inline bool
+switch_from_string(std::string const& _name)
 {
-    class Death
-        : public std::runtime_error
-    {
-        typedef std::runtime_error Base_class;
+    if ("on" == _name || "off" == _name) {
+        return "on" == _name;
+    }
 
-    public:
-        Death()
-            : Base_class("Philosopher died")
-        {}
-    };
+    throw std::invalid_argument("Unknown switch: " + _name);
+}
 
+/// @brief moves running canteen towards target number of seats, one seat added or removed at a random place per interval
+class Seat_resizer
+{
 public:
-    enum class States
-    {
-        thinks,
-        hungry,
-        dines,
-#ifdef PHILOSOPHERS_STARVATION
-        dead
-#endif
-    };
-
-    Philosopher(unsigned _id, std::shared_ptr<Fork> const& _p_left, std::shared_ptr<Fork> const& _p_right, Monitor* _p_canteen)
-        : m_id(_id)
-        , m_state(States::thinks)
-        , m_p_left_fork(_p_left)
-        , m_p_right_fork(_p_right)
-        , m_kill_request(false)
-        , m_p_monitor(_p_canteen)
-#ifdef PHILOSOPHERS_STARVATION
-        , m_last_eating(steady_clock::now())
-#endif
+    Seat_resizer(Canteen& _canteen, unsigned _target, std::chrono::milliseconds _interval)
+        : m_canteen(_canteen)
+        , m_target(_target)
+        , m_interval(_interval)
+        , m_random_engine(g_seed)
+        , m_is_stopped(false)
+        , m_thread(&Seat_resizer::worker, this)
     {}
 
-    void
-        kill()
-    {
-        this->m_kill_request = true;
-    }
+    Seat_resizer(Seat_resizer const&) = delete;
+    Seat_resizer& operator=(Seat_resizer const&) = delete;
 
-    unsigned
-        id()const
+    ~Seat_resizer()
     {
-        return m_id;
+        {
+            std::lock_guard<std::mutex> lock(this->m_mutex);
+            this->m_is_stopped = true;
+        }
+        this->m_event.notify_one();
+        this->m_thread.join();
     }
 
+private:
     void
-        operator()()
+        worker()
     {
-        try {
-            while (!m_kill_request) {
-                thinking();
-                aquire_forks();
-                eating();
+        std::unique_lock<std::mutex> lock(this->m_mutex);
+
+        while (!this->m_event.wait_for(lock, this->m_interval, [this]() {
+            return this->m_is_stopped;
+        })) {
+            try {
+                std::vector<unsigned> const seats = this->m_canteen.seats();
+
+                if (seats.size() == this->m_target) {
+                    return;
+                }
+
+                unsigned const seat = seats[std::uniform_int_distribution<std::size_t>(0, seats.size() - 1)(this->m_random_engine)];
+                steady_clock::time_point const begin = steady_clock::now();
+
+                if (seats.size() < this->m_target) {
+                    unsigned const added = this->m_canteen.add_seat(seat);
+                    std::cout << "Seat " << added << " added after " << seat;
+                } else {
+                    this->m_canteen.remove_seat(seat);
+                    std::cout << "Seat " << seat << " removed";
+                }
+
+                std::cout << " in " << std::chrono::duration_cast<std::chrono::microseconds>(steady_clock::now() - begin).count()
+                          << " us, " << this->m_canteen.seats().size() << " seats" << std::endl;
+            } catch (std::runtime_error const&) {
+                // canteen is stopped while a neighbour of the seat is paused, the run is over
+                return;
+            } catch (std::exception const& _excp) {
+                std::cerr << "Catch std::exception in seat resizer: " << _excp.what() << std::endl;
+                return;
             }
-            throw Death();
-        } catch (Death const&) {
-            this->state(States::dead);
-        } catch (...) {
-            std::cerr << "Catch unhandled exception in philosopher id=" << id() << std::endl;
         }
     }
 
-    /// common thread worker
-    static void
-        worker(std::shared_ptr<Philosopher> const& _p_philosopfer)
-    {
-        (*_p_philosopfer)();
-    }
+    Canteen& m_canteen;
+    unsigned const m_target;
+    std::chrono::milliseconds const m_interval;
+    std::default_random_engine m_random_engine;
+    std::mutex m_mutex;
+    std::condition_variable m_event;
+    bool m_is_stopped;
+    std::thread m_thread;
+};
 
-    States
-        state()const
-    {
-        return m_state;
+/// @brief throughput and latency of a finished run, statistics are printed if the monitor collects them
+inline void
+print_run_summary(std::ostream& _out, Counters_snapshot const& _counters, Clock::time_point::duration _run_time, Monitor& _monitor)
+{
+    if (Fan_out_monitor* const p_fan_out = dynamic_cast<Fan_out_monitor*>(&_monitor)) {
+        p_fan_out->wait_until_consumed();
     }
 
-private:
-    void
-        thinking()
-    {
-        state(States::thinks);
-        std::this_thread::sleep_for(random_interval());
+    double const seconds = std::chrono::duration<double>(_run_time).count();
+    char line[512];
+    std::snprintf(line, sizeof line, "Run %.3fs", seconds);
+    _out << line;
+#ifdef PHILOSOPHERS_COUNTERS
+    std::uint64_t const meals = _counters[Counters::meals];
+    std::snprintf(line, sizeof line, " | meals %llu, %.1f/s, mean hunger %s, try failures %llu",
+                  static_cast<unsigned long long>(meals),
+                  seconds > 0. ? double(meals) / seconds : 0.,
+                  duration_string(meals ? _counters[Counters::hungry_ns] / meals : 0).c_str(),
+                  static_cast<unsigned long long>(_counters[Counters::try_failures]));
+    _out << line;
+#else
+    (void)_counters;
+#endif
+
+    if (Statistics_monitor const* const p_statistics = find_statistics(_monitor)) {
+        std::snprintf(line, sizeof line, " | hungry p50 %s p99 %s max %s, fairness %.4f, deaths %llu",
+                      duration_string(p_statistics->hunger().percentile(0.5)).c_str(),
+                      duration_string(p_statistics->hunger().percentile(0.99)).c_str(),
+                      duration_string(p_statistics->hunger().max()).c_str(),
+                      p_statistics->fairness(),
+                      static_cast<unsigned long long>(p_statistics->deaths()));
+        _out << line;
     }
 
-    void
-        aquire_forks()
+    _out << " | dropped events " << _monitor.dropped() << std::endl;
+}
+
+/// @brief command-line options
+struct Options
+{
+    Options()
+        : m_max_interval(10000)
+        , m_interval_unit(Interval_units::ms)
+        , m_work(Work_modes::sleep)
+        , m_seed(unsigned(std::chrono::system_clock::now().time_since_epoch().count()))
+        , m_spin_limit_us(0)
+        , m_is_stdio_unsynced(false)
+        , m_monitors(1, Monitors::waterfall)
+        , m_trace_file("philosophers.trace")
+        , m_number_of_tables(1)
+        , m_transfer_interval(0)
+        , m_summary_interval(1)
+        , m_metrics_port(-1)
+        , m_topology("ring")
+        , m_resize_target(0)
+        , m_resize_interval(1000)
+    {}
+
+    /// @brief positional arguments and `--name=value` options in any order
+    static Options
+        parse(int argc, char* argv[])
     {
-        state(States::hungry);
+        Options options;
+        unsigned position = 0;
 
-        for (;;) {
-            while (!this->m_p_left_fork->wait_until_available()) {
-                check_for_death();
-            }
+        std::vector<std::string> args(argv + 1, argv + argc);
 
-            if (this->m_p_right_fork->try_to_get()) {
-                break;
-            }
+        for (std::size_t i = 0; i < args.size(); ++i) {
+            std::string const arg = args[i];
 
-            this->m_p_left_fork->free();
+            if (0 != arg.compare(0, 2, "--")) {
+                switch (position++) {
+                case 0:
+                    options.m_canteen.m_number_of_philosophers = std::max(2, atoi(arg.c_str()));
+                    break;
 
-            while (!this->m_p_right_fork->wait_until_available()) {
-                check_for_death();
-            }
+                case 1:
+                    options.m_max_interval = unsigned(std::max(1, atoi(arg.c_str())));
+                    break;
 
-            if (this->m_p_left_fork->try_to_get()) {
-                break;
+                default:
+                    throw std::invalid_argument("Unexpected argument: " + arg);
+                }
+
+                continue;
             }
 
-            this->m_p_right_fork->free();
+            std::string::size_type const eq_pos = arg.find('=');
+            std::string const name = arg.substr(2, eq_pos == std::string::npos ? std::string::npos : eq_pos - 2);
+            std::string const value = eq_pos == std::string::npos ? std::string() : arg.substr(eq_pos + 1);
+
+            if (name == "policy") {
+                options.m_canteen.m_fork_policy = fork_policy_from_string(value);
+            } else if (name == "unit") {
+                options.m_interval_unit = interval_unit_from_string(value);
+            } else if (name == "work") {
+                options.m_work = work_mode_from_string(value);
+            } else if (name == "mode") {
+                options.m_canteen.m_execution_mode = execution_mode_from_string(value);
+            } else if (name == "log-queue") {
+                options.m_log_queue.m_queue = log_queue_from_string(value);
+            } else if (name == "log-overflow") {
+                options.m_log_queue.m_overflow_policy = overflow_policy_from_string(value);
+            } else if (name == "log-capacity") {
+                options.m_log_queue.m_capacity = unsigned(std::max(2, atoi(value.c_str())));
+            } else if (name == "frame-ms") {
+                options.m_output.m_frame_interval = std::chrono::milliseconds(std::max(0, atoi(value.c_str())));
+            } else if (name == "waterfall") {
+                options.m_output.m_waterfall_mode = waterfall_mode_from_string(value);
+            } else if (name == "fps") {
+                options.m_output.m_frames_per_second = unsigned(std::max(0, atoi(value.c_str())));
+            } else if (name == "unsync-stdio") {
+                options.m_is_stdio_unsynced = true;
+            } else if (name == "monitor") {
+                options.m_monitors.clear();
+
+                for (std::string::size_type begin = 0; begin <= value.size();) {
+                    std::string::size_type const end = std::min(value.find(',', begin), value.size());
+                    options.m_monitors.push_back(monitor_from_string(value.substr(begin, end - begin)));
+                    begin = end + 1;
+                }
+
+                bool const is_none = std::count(options.m_monitors.cbegin(), options.m_monitors.cend(), Monitors::none) > 0;
+
+                if (is_none && options.m_monitors.size() > 1) {
+                    throw std::invalid_argument("Monitor none could not be combined with others: " + value);
+                }
+
+                options.m_canteen.m_is_monitored = !is_none;
+            } else if (name == "starvation") {
+                options.m_canteen.m_is_starvation_enabled = switch_from_string(value);
+            } else if (name == "summary") {
+                options.m_summary_interval = std::chrono::seconds(std::max(1, atoi(value.c_str())));
+            } else if (name == "metrics") {
+                options.m_metrics_port = std::min(65535, std::max(0, atoi(value.c_str())));
+            } else if (name == "resize") {
+                options.m_resize_target = unsigned(std::max(2, atoi(value.c_str())));
+            } else if (name == "resize-ms") {
+                options.m_resize_interval = std::chrono::milliseconds(std::max(1, atoi(value.c_str())));
+            } else if (name == "trace-file") {
+                options.m_trace_file = value;
+            } else if (name == "play") {
+                options.m_play_file = value;
+            } else if (name == "replay") {
+                options.m_replay_file = value;
+            } else if (name == "topology") {
+                options.m_topology = value;
+            } else if (name == "think") {
+                options.m_canteen.m_workload.m_thinking = interval_profile_from_string(value);
+            } else if (name == "eat") {
+                options.m_canteen.m_workload.m_eating = interval_profile_from_string(value);
+            } else if (name == "hot-seats") {
+                options.m_canteen.m_workload.m_hot_seats = seats_from_string(value);
+            } else if (name == "hot-factor") {
+                options.m_canteen.m_workload.m_hot_factor = std::max(0.001, std::strtod(value.c_str(), nullptr));
+            } else if (name == "workload") {
+                // options of the file apply in place, so later arguments override them
+                std::vector<std::string> const lines = workload_file(value);
+                args.insert(args.begin() + std::ptrdiff_t(i + 1), lines.cbegin(), lines.cend());
+            } else if (name == "duration") {
+                options.m_canteen.m_duration = std::chrono::seconds(std::max(0, atoi(value.c_str())));
+            } else if (name == "meals-per-philosopher") {
+                options.m_canteen.m_meals_per_philosopher = std::strtoull(value.c_str(), nullptr, 10);
+            } else if (name == "total-meals") {
+                options.m_canteen.m_total_meals = std::strtoull(value.c_str(), nullptr, 10);
+            } else if (name == "tables") {
+                options.m_number_of_tables = unsigned(std::max(1, atoi(value.c_str())));
+            } else if (name == "transfer") {
+                options.m_transfer_interval = std::chrono::seconds(std::max(0, atoi(value.c_str())));
+            } else if (name == "affinity") {
+                options.m_canteen.m_affinity = affinity_from_string(value);
+            } else if (name == "layout") {
+                options.m_canteen.m_layout = layout_from_string(value);
+            } else if (name == "workers") {
+                options.m_canteen.m_number_of_workers = unsigned(std::max(0, atoi(value.c_str())));
+            } else if (name == "seed") {
+                options.m_seed = unsigned(std::strtoul(value.c_str(), nullptr, 0));
+            } else if (name == "spin-us") {
+                options.m_spin_limit_us = unsigned(std::max(0, atoi(value.c_str())));
+            } else {
+                throw std::invalid_argument("Unknown option: " + arg);
+            }
         }
+
+        return options;
     }
 
-    void
-        check_for_death()
+    /// @brief `name=value` lines of workload file as `--name=value` options, `#` starts a comment
+    static std::vector<std::string>
+        workload_file(std::string const& _path)
     {
-#ifdef PHILOSOPHERS_STARVATION
-        using namespace std::chrono;
-        milliseconds const time_span = duration_cast<milliseconds>(steady_clock::now() - this->m_last_eating);
+        std::ifstream file(_path);
 
-        if (milliseconds(m_death_threshold * g_max_interval_ms) < time_span) {
-            throw Death();
+        if (!file) {
+            throw std::invalid_argument("Can not open workload file: " + _path);
         }
 
-#endif
-    }
+        std::vector<std::string> result;
+        std::string line;
 
-    void
-        eating()
-    {
-        state(States::dines);
-        std::this_thread::sleep_for(random_interval());
-        this->m_p_right_fork->free();
-        this->m_p_left_fork->free();
-#ifdef PHILOSOPHERS_STARVATION
-        this->m_last_eating = steady_clock::now();
-#endif
-    }
+        while (std::getline(file, line)) {
+            line.erase(std::min(line.find('#'), line.size()));
+            std::string::size_type const eq_pos = line.find('=');
 
-    std::chrono::milliseconds
-        random_interval()const
-    {
-        /// @brief mutex protected random generator
-        class Random_generator
-            : public std::default_random_engine
-        {
-            typedef std::default_random_engine Base_class;
-        public:
-            Random_generator()
-                : Base_class(result_type(std::chrono::system_clock::now().time_since_epoch().count()))
-            {}
-            result_type
-                operator()()
-            {
-                std::lock_guard<decltype(m_mutex)> guard(m_mutex);
-                return Base_class::operator()();
+            if (eq_pos == std::string::npos) {
+                if (line.find_first_not_of(" \t\r") != std::string::npos) {
+                    throw std::invalid_argument("Invalid line of workload file: " + line);
+                }
+
+                continue;
             }
 
-        private:
-            std::mutex m_mutex;
-        };
-        static Random_generator g_rnd;
-        static std::uniform_int_distribution<unsigned> distribution(1, g_max_interval_ms);
-        return std::chrono::milliseconds(distribution(g_rnd));
+            result.push_back("--" + trimmed(line.substr(0, eq_pos)) + "=" + trimmed(line.substr(eq_pos + 1)));
+        }
+
+        return result;
     }
 
-    inline void
-        state(States _state);
+    static std::string
+        trimmed(std::string const& _value)
+    {
+        std::string::size_type const first = _value.find_first_not_of(" \t\r");
+        return first == std::string::npos ? std::string() : _value.substr(first, _value.find_last_not_of(" \t\r") + 1 - first);
+    }
 
-    unsigned m_id;
-    States m_state;
-    std::shared_ptr<Fork> m_p_left_fork;
-    std::shared_ptr<Fork> m_p_right_fork;
-    bool volatile m_kill_request;
-    Monitor* m_p_monitor;
+    Canteen_config m_canteen;
+    Log_queue_config m_log_queue;
+    Output_config m_output;
+    /// in m_interval_unit
+    unsigned m_max_interval;
+    Interval_units m_interval_unit;
+    Work_modes m_work;
+    unsigned m_seed;
+    /// see g_spin_limit_us
+    unsigned m_spin_limit_us;
+    bool m_is_stdio_unsynced;
+    /// several monitors are fed by Fan_out_monitor
+    std::vector<Monitors> m_monitors;
+    std::string m_trace_file;
+    /// replay trace file into monitor instead of running canteen
+    std::string m_play_file;
+    /// simulate canteen with intervals and meals order of trace file
+    std::string m_replay_file;
+    /// philosophers are split between tables of Banquet if more than 1
+    unsigned m_number_of_tables;
+    std::chrono::seconds m_transfer_interval;
+    /// of stats monitor
+    std::chrono::seconds m_summary_interval;
+    /// port of Metrics_server, 0 - any free port, -1 - no metrics
+    int m_metrics_port;
+    /// see Topology::from_string()
+    std::string m_topology;
+    /// number of seats Seat_resizer moves the canteen to, 0 - fixed ring
+    unsigned m_resize_target;
+    std::chrono::milliseconds m_resize_interval;
+
+    std::unique_ptr<Monitor>
+        make_monitor()const
+    {
+        bool const is_statistics_added = this->m_metrics_port >= 0 && this->m_canteen.m_is_monitored
+                                         && std::count(this->m_monitors.cbegin(), this->m_monitors.cend(), Monitors::stats) == 0;
 
-#ifdef PHILOSOPHERS_STARVATION
-    steady_clock::time_point m_last_eating;
-    static unsigned const m_death_threshold = 4;
-#endif
-};
+        if (1 == this->m_monitors.size() && !is_statistics_added) {
+            return make_monitor(this->m_monitors.front());
+        }
 
-class Monitor
-{
-public:
-    typedef std::pair<unsigned, Philosopher::States> state_log_element_type;
+        std::vector<std::unique_ptr<Monitor>> sinks;
 
-    void
-        log_state(Philosopher const* _p_philosopher)
-    {
-        if (!_p_philosopher) {
-            return;
+        for (Monitors const monitor : this->m_monitors) {
+            sinks.push_back(make_monitor(monitor));
         }
 
-        {
-            std::lock_guard<decltype(this->m_log_queue_mutex)> locker(this->m_log_queue_mutex);
-            m_log_queue.emplace_back(_p_philosopher->id(), _p_philosopher->state());
+        // histograms of metrics are collected silently
+        if (is_statistics_added) {
+            sinks.push_back(std::unique_ptr<Monitor>(new Statistics_monitor(this->m_log_queue)));
         }
 
-        this->m_state_logged_event.notify_one();
+        return std::unique_ptr<Monitor>(new Fan_out_monitor(std::move(sinks), this->m_log_queue));
     }
 
-    void
-        monitor_worker()
+    /// @brief metrics server of the running monitor, nullptr if not requested
+    std::unique_ptr<Metrics_server>
+        make_metrics_server(Monitor const& _monitor)const
     {
-        std::mutex event_mutex;
-        std::unique_lock<decltype(event_mutex)> locker(event_mutex);
-        decltype(m_log_queue) work_log;
-
-        for (;;) {
-            if (!this->m_log_queue.empty()) {
-                {
-                    std::lock_guard<decltype(this->m_log_queue_mutex)> locker(this->m_log_queue_mutex);
-                    std::swap(work_log, m_log_queue);
-                }
-                events_logger(work_log);
-                work_log.clear();
-            } else if (std::cv_status::timeout == this->m_state_logged_event.wait_for(locker, std::chrono::milliseconds(10 * g_max_interval_ms))) {
-                throw std::runtime_error("No events for a long time");
-            }
+        if (this->m_metrics_port < 0) {
+            return std::unique_ptr<Metrics_server>();
         }
+
+        std::unique_ptr<Metrics_server> p_server(new Metrics_server(unsigned(this->m_metrics_port), _monitor, find_statistics(_monitor)));
+        std::cout << "Metrics http://127.0.0.1:" << p_server->port() << "/metrics" << std::endl;
+        return p_server;
     }
 
-protected:
-    typedef std::vector<state_log_element_type> log_queue_type;
-    virtual void
-        events_logger(log_queue_type const& work_log) = 0;
+    std::unique_ptr<Monitor>
+        make_monitor(Monitors _monitor)const
+    {
+        switch (_monitor) {
+        case Monitors::log:
+            return std::unique_ptr<Monitor>(new Simple_log_monitor(this->m_log_queue, this->m_output));
 
-    std::mutex mutable m_log_queue_mutex;
-    std::condition_variable m_state_logged_event;
-    log_queue_type m_log_queue;
-};
+        case Monitors::trace:
+            return std::unique_ptr<Monitor>(new Trace_monitor(this->m_trace_file, this->m_log_queue));
 
-void
-Philosopher::state(States _state)
-{
-    this->m_state = _state;
+        case Monitors::stats:
+            return std::unique_ptr<Monitor>(new Summary_monitor(std::cout, this->m_summary_interval, this->m_log_queue));
+
+        case Monitors::none:
+            return std::unique_ptr<Monitor>(new Null_monitor);
 
-    if (this->m_p_monitor) {
-        this->m_p_monitor->log_state(this);
+        default:
+            return std::unique_ptr<Monitor>(new Waterfall_monitor(this->m_log_queue, this->m_output));
+        }
     }
-}
+};
+
+}  // namespace philosophers
 
-class Canteen
+int
+main(int argc, char* argv[])
 {
-public:
-    explicit
-        Canteen(Monitor& _monitor, unsigned _number_of_philosophers)
-        : m_p_monitor(&_monitor)
-    {
-        if (_number_of_philosophers < 2) {
-            throw std::invalid_argument("Invalid number of philosophers (<2)");
+    try {
+        using namespace philosophers;
+        Options const options = Options::parse(argc, argv);
+
+        // has effect only before the first input or output of standard streams
+        if (options.m_is_stdio_unsynced) {
+            std::ios_base::sync_with_stdio(false);
         }
 
-        std::vector<std::shared_ptr<Fork>> forks;
-        forks.reserve(_number_of_philosophers);
+        std::cout << "Dining philosophers problem " << GIT_DESCRIBE << std::endl;
+
+        set_intervals(options.m_max_interval, options.m_interval_unit, options.m_work);
+        g_seed = options.m_seed;
+        g_spin_limit_us = options.m_spin_limit_us;
+        std::cout << "Seed " << g_seed << std::endl;
+        Workload const& workload = options.m_canteen.m_workload;
 
-        for (unsigned i = 0; i < _number_of_philosophers; ++i) {
-            forks.push_back(std::make_shared<Fork>(i));
+        if (Distributions::uniform != workload.m_thinking.m_distribution || Distributions::uniform != workload.m_eating.m_distribution
+                || !workload.m_hot_seats.empty()) {
+            std::cout << "Workload think " << to_string(workload.m_thinking) << ", eat " << to_string(workload.m_eating)
+                      << ", " << workload.m_hot_seats.size() << " hot seats eating " << workload.m_hot_factor << " times longer" << std::endl;
+        }
+        std::unique_ptr<Monitor> const p_monitor = options.make_monitor();
+
+        if (!options.m_play_file.empty()) {
+            Trace_reader const reader(options.m_play_file);
+            std::cout << "Trace of " << reader.header().m_git_describe << ", "
+                      << reader.header().m_number_of_seats << " seats, "
+                      << reader.header().m_number_of_records << " events" << std::endl;
+            reader.replay(*p_monitor);
+            return 0;
         }
 
-        this->m_philosophers.reserve(_number_of_philosophers);
+        Canteen_config canteen_config = options.m_canteen;
+        // new seats get their own ids and counters
+        canteen_config.m_seat_capacity = options.m_resize_target;
 
-        for (unsigned i = 0; i < _number_of_philosophers; ++i) {
-            this->m_philosophers.push_back(std::make_shared<Philosopher>(
-                i,
-                forks[i],
-                forks[(i + 1) % _number_of_philosophers],
-                this->m_p_monitor));
-        }
-    }
+        if (!options.m_replay_file.empty()) {
+            if (options.m_number_of_tables > 1) {
+                throw std::invalid_argument("Trace is replayed at a single table");
+            }
 
-    void
-        operator()()
-    {
-        std::vector<std::thread> threads;
-        threads.reserve(this->m_philosophers.size());
-
-        try {
-            auto const thread_creator = [](std::shared_ptr<Philosopher> const & ptr) {
-                return std::thread(Philosopher::worker, ptr);
-            };
-            std::transform(this->m_philosophers.cbegin(), m_philosophers.cend(),
-                           std::back_inserter(threads),
-                           thread_creator);
-            this->m_p_monitor->monitor_worker();
-        } catch (std::exception const& _excp) {
-            std::cerr << "Catch std::exception:" << _excp.what() << std::endl;
-        } catch (...) {
-            std::cerr << "Catch Unknown exception!" << std::endl;
-        }
+            Trace_reader const reader(options.m_replay_file);
+            std::cout << "Replay schedule of " << reader.header().m_git_describe << ", "
+                      << reader.header().m_number_of_seats << " seats, "
+                      << reader.header().m_number_of_records << " events" << std::endl;
+            canteen_config.m_number_of_philosophers = reader.header().m_number_of_seats;
 
-        for (auto p : this->m_philosophers) {
-            p->kill();
-        }
+            // starvation deadlines and intervals after the end of the script follow the recorded run
+            if (0 != reader.header().m_max_interval_ms) {
+                set_intervals(reader.header().m_max_interval_ms, Interval_units::ms, options.m_work);
+            }
 
-        for (auto& thr : threads) {
-            thr.join();
+            canteen_config.m_fork_policy = Fork_policies(reader.header().m_fork_policy);
+            canteen_config.m_execution_mode = Execution_modes::simulation;
+            canteen_config.m_p_script = std::make_shared<Schedule_script const>(reader.script());
         }
 
-        throw std::logic_error("Unexpected exit");
-    }
+        // virtual time is not bounded by wall-clock time, and philosophers never die without starvation
+        if (Execution_modes::simulation == canteen_config.m_execution_mode
+                && 0 == canteen_config.m_duration.count() && !canteen_config.has_meal_quota()) {
+            throw std::invalid_argument("Simulation needs --duration or a meal quota");
+        }
 
-private:
-    std::vector<std::shared_ptr<Philosopher>> m_philosophers;
-    Monitor* const m_p_monitor;
-};
+        if ("ring" != options.m_topology) {
+            if (options.m_number_of_tables > 1 || options.m_resize_target || !options.m_replay_file.empty()) {
+                throw std::invalid_argument("Topology is built for a single fixed table without replay");
+            }
 
-class Simple_log_monitor
-    : public Monitor
-{
-protected:
-    void
-        events_logger(log_queue_type const& work_log) override
-    {
-        auto const log_event = [](log_queue_type::value_type const & el) {
-            std::cout << "Philosopher #" << el.first << " ";
-
-            switch (el.second) {
-            case Philosopher::States::thinks:
-                std::cout << "thinks";
-                break;
-
-            case Philosopher::States::hungry:
-                std::cout << "hungry";
-                break;
-
-            case Philosopher::States::dines:
-                std::cout << "dines";
-                break;
-
-#ifdef PHILOSOPHERS_STARVATION
-            case Philosopher::States::dead:
-                std::cout << "die";
-                break;
-#endif
+            std::shared_ptr<Topology const> const p_topology = std::make_shared<Topology const>(
+                        Topology::from_string(options.m_topology, canteen_config.m_number_of_philosophers, g_seed));
+            std::cout << "Topology " << p_topology->name() << ", " << p_topology->number_of_seats() << " seats, "
+                      << p_topology->number_of_forks() << " forks, " << p_topology->number_of_edges() << " edges" << std::endl;
+            canteen_config.m_number_of_philosophers = p_topology->number_of_seats();
+            canteen_config.m_p_topology = p_topology;
+        }
 
-            default:
-                std::cout << "?????";
-                break;
+        if (options.m_number_of_tables > 1) {
+            if (options.m_resize_target) {
+                throw std::invalid_argument("Seats are resized at a single table");
             }
 
-            std::cout << std::endl;
-        };
-
-        std::for_each(std::begin(work_log), std::end(work_log), log_event);
-    }
-};
+            if (canteen_config.has_meal_quota()) {
+                throw std::invalid_argument("Meal quota is counted at a single table");
+            }
 
-class Waterfall_monitor
-    : public Monitor
-{
-protected:
-    void
-        events_logger(log_queue_type const& work_log)override
-    {
-        auto const log_event = [this](log_queue_type::value_type const & el) {
-            if (this->m_buffer.size() <= el.first) {
-                this->m_buffer.append(el.first + 1 - this->m_buffer.size(), symb(Philosopher::States::thinks));
+            Banquet_config config;
+            config.m_canteen = canteen_config;
+            config.m_number_of_tables = options.m_number_of_tables;
+            config.m_transfer_interval = options.m_transfer_interval;
+            config.m_log_queue = options.m_log_queue;
+            Banquet banquet(*p_monitor, config);
+            banquet.print_affinity(std::cout);
+            std::unique_ptr<Metrics_server> const p_metrics = options.make_metrics_server(*p_monitor);
+            std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+
+            if (Execution_modes::simulation != canteen_config.m_execution_mode && canteen_config.m_duration.count() > 0) {
+                banquet.run_for(canteen_config.m_duration);
+            } else {
+                banquet();
             }
 
-            this->m_buffer[el.first] = symb(el.second);
-        };
-        std::for_each(std::begin(work_log), std::end(work_log), log_event);
-        std::cout << this->m_buffer << std::endl;
-    }
+            print_run_summary(std::cout, banquet.counters_snapshot(), std::chrono::steady_clock::now() - start, *p_monitor);
 
-private:
-    static char
-        symb(Philosopher::States _state)
-    {
-        switch (_state) {
-        case Philosopher::States::thinks:
-            return ' ';
-            break;
-
-        case Philosopher::States::hungry:
-            return '.';
-            break;
-
-        case Philosopher::States::dines:
-            return '|';
-            break;
-
-#ifdef PHILOSOPHERS_STARVATION
-        case Philosopher::States::dead:
-            return '#';
-            break;
-#endif
+            if (banquet.restarts()) {
+                std::cout << "Transfers " << banquet.transfers() << ", all tables rebuilt " << banquet.restarts() << " times in "
+                          << duration_string(std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(banquet.restart_time()).count()))
+                          << std::endl;
+            }
 
-        default:
-            return '?';
-            break;
+            return 0;
         }
-    }
-
-    std::string m_buffer;
-};
 
-}  // namespace philosophers
+        Canteen canteen(*p_monitor, canteen_config);
+        canteen.affinity_map().print(std::cout);
+        // server is stopped before canteen detaches counters
+        std::unique_ptr<Metrics_server> const p_metrics = options.make_metrics_server(*p_monitor);
+        std::unique_ptr<Seat_resizer> const p_resizer(options.m_resize_target
+                ? new Seat_resizer(canteen, options.m_resize_target, options.m_resize_interval)
+                : nullptr);
+
+        // threads and pool run forever unless bounded, simulation is always bounded
+        if (Execution_modes::simulation != canteen_config.m_execution_mode
+                && 0 == canteen_config.m_duration.count() && !canteen_config.has_meal_quota()) {
+            canteen();
+            return 0;
+        }
 
-int
-main(int argc, char* argv[])
-{
-    try {
-        std::cout << "Dining philosophers problem " << GIT_DESCRIBE << std::endl;
-        using namespace philosophers;
-        unsigned const num_ph = argc < 2 ? 64 : std::max(2, atoi(argv[1]));
-        g_max_interval_ms = argc < 3 ? 10000 : std::max(2, atoi(argv[2]));
-        Waterfall_monitor wf_monitor;
-        Canteen canteen(wf_monitor, num_ph);
-        canteen();
+        canteen.run_for(canteen_config.m_duration.count() > 0 ? canteen_config.m_duration : std::chrono::seconds::max());
+        print_run_summary(std::cout, p_monitor->counters_snapshot(), canteen.run_time(), *p_monitor);
         return 0;
     } catch (std::exception const& exc) {
         std::cerr << "Unhandled std::exception: " << exc.what() << std::endl;
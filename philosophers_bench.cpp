@@ -0,0 +1,334 @@
+#include "banquet.hpp"
+#include "canteen.hpp"
+#include "statistics.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace philosophers {
+namespace bench {
+
+/// @brief matrix of benchmarked configurations
+struct Options
+{
+    Options()
+        : m_seats{16, 256}
+        , m_intervals{2, 20}
+        , m_policies{Fork_policies::back_off, Fork_policies::ordered, Fork_policies::waiter, Fork_policies::chandy_misra}
+        , m_modes{Execution_modes::threads, Execution_modes::pool, Execution_modes::simulation}
+        , m_layouts{Layouts::scattered, Layouts::contiguous}
+        , m_affinities{Affinities::none, Affinities::neighbours}
+        , m_tables{1}
+        , m_starvation{Canteen_config().m_is_starvation_enabled}
+        , m_duration(2)
+        , m_transfer_interval(0)
+        , m_number_of_workers(0)
+        , m_seed(1)
+        , m_spin_limit_us(0)
+        , m_interval_unit(Interval_units::ms)
+        , m_works{Work_modes::sleep}
+        , m_workloads{Interval_profile()}
+        , m_topologies{"ring"}
+        , m_hot_factor(Workload().m_hot_factor)
+    {}
+
+    static Options
+        parse(int argc, char* argv[])
+    {
+        Options options;
+
+        for (int i = 1; i < argc; ++i) {
+            std::string const arg = argv[i];
+            std::string::size_type const eq_pos = arg.find('=');
+
+            if (0 != arg.compare(0, 2, "--") || eq_pos == std::string::npos) {
+                throw std::invalid_argument("Unexpected argument: " + arg);
+            }
+
+            std::string const name = arg.substr(2, eq_pos - 2);
+            std::string const value = arg.substr(eq_pos + 1);
+
+            if (name == "seats") {
+                options.m_seats = list(value, [](std::string const& _item) {
+                    return unsigned(std::max(2, atoi(_item.c_str())));
+                });
+            } else if (name == "intervals") {
+                options.m_intervals = list(value, [](std::string const& _item) {
+                    return unsigned(std::max(1, atoi(_item.c_str())));
+                });
+            } else if (name == "unit") {
+                options.m_interval_unit = interval_unit_from_string(value);
+            } else if (name == "work-modes") {
+                options.m_works = list(value, work_mode_from_string);
+            } else if (name == "policies") {
+                options.m_policies = list(value, fork_policy_from_string);
+            } else if (name == "modes") {
+                options.m_modes = list(value, execution_mode_from_string);
+            } else if (name == "layouts") {
+                options.m_layouts = list(value, layout_from_string);
+            } else if (name == "tables") {
+                options.m_tables = list(value, [](std::string const& _item) {
+                    return unsigned(std::max(1, atoi(_item.c_str())));
+                });
+            } else if (name == "starvation") {
+                options.m_starvation = list(value, [](std::string const& _item) {
+                    if ("on" == _item || "off" == _item) {
+                        return "on" == _item;
+                    }
+
+                    throw std::invalid_argument("Unknown switch: " + _item);
+                });
+            } else if (name == "affinities") {
+                options.m_affinities = list(value, affinity_from_string);
+            } else if (name == "workloads") {
+                options.m_workloads = list(value, interval_profile_from_string);
+            } else if (name == "topologies") {
+                options.m_topologies = list(value, [](std::string const& _item) {
+                    return _item;
+                });
+            } else if (name == "hot-seats") {
+                options.m_hot_seats = seats_from_string(value);
+            } else if (name == "hot-factor") {
+                options.m_hot_factor = std::max(0.001, std::strtod(value.c_str(), nullptr));
+            } else if (name == "duration") {
+                options.m_duration = std::chrono::seconds(std::max(1, atoi(value.c_str())));
+            } else if (name == "transfer") {
+                options.m_transfer_interval = std::chrono::seconds(std::max(0, atoi(value.c_str())));
+            } else if (name == "workers") {
+                options.m_number_of_workers = unsigned(std::max(0, atoi(value.c_str())));
+            } else if (name == "seed") {
+                options.m_seed = unsigned(std::strtoul(value.c_str(), nullptr, 0));
+            } else if (name == "spin-us") {
+                options.m_spin_limit_us = unsigned(std::max(0, atoi(value.c_str())));
+            } else {
+                throw std::invalid_argument("Unknown option: " + arg);
+            }
+        }
+
+        return options;
+    }
+
+    std::vector<unsigned> m_seats;
+    /// interval scales, max_interval of every run in m_interval_unit
+    std::vector<unsigned> m_intervals;
+    std::vector<Fork_policies> m_policies;
+    std::vector<Execution_modes> m_modes;
+    std::vector<Layouts> m_layouts;
+    std::vector<Affinities> m_affinities;
+    /// numbers of Banquet tables sharing the seats
+    std::vector<unsigned> m_tables;
+    /// starvation enabled or not
+    std::vector<bool> m_starvation;
+    /// of every run, simulated time in simulation mode
+    std::chrono::seconds m_duration;
+    /// guest transfer interval of banquets, every transfer rebuilds all tables, 0 - no transfers
+    std::chrono::seconds m_transfer_interval;
+    unsigned m_number_of_workers;
+    unsigned m_seed;
+    /// see g_spin_limit_us
+    unsigned m_spin_limit_us;
+    Interval_units m_interval_unit;
+    std::vector<Work_modes> m_works;
+    /// distributions of both thinking and eating intervals
+    std::vector<Interval_profile> m_workloads;
+    std::vector<std::string> m_topologies;
+    std::vector<unsigned> m_hot_seats;
+    double m_hot_factor;
+
+private:
+    /// @brief comma separated list
+    template<typename Parser>
+    static auto
+        list(std::string const& _value, Parser _parser) -> std::vector<decltype(_parser(_value))>
+    {
+        std::vector<decltype(_parser(_value))> result;
+        std::istringstream stream(_value);
+        std::string item;
+
+        while (std::getline(stream, item, ',')) {
+            result.push_back(_parser(item));
+        }
+
+        return result;
+    }
+};
+
+void
+print_histogram(std::ostream& _out, Histogram const& _histogram)
+{
+    _out << "{\"count\": " << _histogram.count()
+         << ", \"mean\": " << _histogram.mean()
+         << ", \"p50\": " << _histogram.percentile(0.5)
+         << ", \"p90\": " << _histogram.percentile(0.9)
+         << ", \"p99\": " << _histogram.percentile(0.99)
+         << ", \"p999\": " << _histogram.percentile(0.999)
+         << ", \"max\": " << _histogram.max()
+         << ", \"buckets\": [";
+    char const* separator = "";
+
+    for (unsigned i = 0; i < Histogram::number_of_buckets; ++i) {
+        if (_histogram.bucket(i)) {
+            _out << separator << "[" << Histogram::lower_bound(i) << ", " << Histogram::upper_bound(i) << ", " << _histogram.bucket(i) << "]";
+            separator = ", ";
+        }
+    }
+
+    _out << "]}";
+}
+
+/// @brief run one configuration headless and print its JSON result object
+void
+run(std::ostream& _out, Canteen_config const& _config, unsigned _number_of_tables, unsigned _max_interval, Work_modes _work, Options const& _options)
+{
+    set_intervals(_max_interval, _options.m_interval_unit, _work);
+    g_seed = _options.m_seed;
+    g_spin_limit_us = _options.m_spin_limit_us;
+    Statistics_monitor monitor;
+    steady_clock::time_point const start = steady_clock::now();
+    Counters_snapshot counters;
+    unsigned transfers = 0;
+    unsigned restarts = 0;
+    double restart_seconds = 0.;
+
+    if (_number_of_tables > 1) {
+        Banquet_config config;
+        config.m_canteen = _config;
+        config.m_number_of_tables = _number_of_tables;
+        config.m_transfer_interval = _options.m_transfer_interval;
+        Banquet banquet(monitor, config);
+        banquet.run_for(_options.m_duration);
+        counters = banquet.counters_snapshot();
+        transfers = banquet.transfers();
+        restarts = banquet.restarts();
+        restart_seconds = std::chrono::duration<double>(banquet.restart_time()).count();
+    } else {
+        Canteen canteen(monitor, _config);
+        canteen.run_for(_options.m_duration);
+        counters = monitor.counters_snapshot();
+    }
+
+    double const wall_seconds = std::chrono::duration<double>(steady_clock::now() - start).count();
+    double const seconds = double(_options.m_duration.count());
+
+    _out << "{\"seats\": " << _config.m_number_of_philosophers
+         << ", \"tables\": " << _number_of_tables
+         << ", \"transfer_s\": " << (_number_of_tables > 1 ? _options.m_transfer_interval.count() : 0)
+         << ", \"transfers\": " << transfers
+         << ", \"restarts\": " << restarts
+         << ", \"restart_time_s\": " << restart_seconds
+         << ", \"max_interval\": " << _max_interval
+         << ", \"interval_unit\": \"" << to_string(_options.m_interval_unit) << "\""
+         << ", \"work\": \"" << to_string(_work) << "\""
+         << ", \"workload\": \"" << to_string(_config.m_workload.m_eating) << "\""
+         << ", \"hot_seats\": " << _config.m_workload.m_hot_seats.size()
+         << ", \"hot_factor\": " << _config.m_workload.m_hot_factor
+         << ", \"topology\": \"" << (_config.m_p_topology ? _config.m_p_topology->name() : std::string("ring")) << "\""
+         << ", \"forks\": " << (_config.m_p_topology ? _config.m_p_topology->number_of_forks() : _config.m_number_of_philosophers)
+         << ", \"policy\": \"" << to_string(_config.m_fork_policy) << "\""
+         << ", \"fork\": \"" << Fork::name() << "\""
+         << ", \"mode\": \"" << to_string(_config.m_execution_mode) << "\""
+         << ", \"layout\": \"" << to_string(_config.m_layout) << "\""
+         << ", \"affinity\": \"" << to_string(_config.m_affinity) << "\""
+         << ", \"spin_limit_us\": " << _options.m_spin_limit_us
+         << ", \"starvation\": " << (_config.m_is_starvation_enabled ? "true" : "false")
+         << ", \"duration_s\": " << seconds
+         << ", \"wall_time_s\": " << wall_seconds
+         << ", \"meals\": " << monitor.meals()
+         << ", \"meals_per_second\": " << double(monitor.meals()) / seconds
+         << ", \"fairness\": " << monitor.fairness()
+         << ", \"deaths\": " << monitor.deaths()
+         << ", \"near_misses\": " << monitor.near_misses()
+         << ", \"max_hunger_fraction\": " << monitor.max_hunger_fraction()
+         << ", \"hunger_ns\": ";
+    print_histogram(_out, monitor.hunger());
+    _out << ", \"thinking_ns\": ";
+    print_histogram(_out, monitor.thinking());
+    _out << ", \"dining_ns\": ";
+    print_histogram(_out, monitor.dining());
+    _out << ", \"counters\": {";
+
+    for (std::size_t i = 0; i < number_of_counters; ++i) {
+        _out << (i ? ", " : "") << "\"" << to_string(Counters(i)) << "\": " << counters.m_values[i];
+    }
+
+    _out << "}}";
+}
+
+}  // namespace bench
+}  // namespace philosophers
+
+int
+main(int argc, char* argv[])
+{
+    try {
+        using namespace philosophers;
+        bench::Options const options = bench::Options::parse(argc, argv);
+        std::cout << "{\"git_describe\": \"" << GIT_DESCRIBE << "\", \"seed\": " << options.m_seed << ", \"results\": [" << std::endl;
+        char const* separator = "";
+
+        for (unsigned const seats : options.m_seats) {
+            for (unsigned const interval : options.m_intervals) {
+                for (Work_modes const work : options.m_works) {
+                    for (Fork_policies const policy : options.m_policies) {
+                        for (Execution_modes const mode : options.m_modes) {
+                            for (Layouts const layout : options.m_layouts) {
+                                for (Affinities const affinity : options.m_affinities) {
+                                    for (unsigned const tables : options.m_tables) {
+                                        for (bool const starvation : options.m_starvation) {
+                                            for (std::string const& topology : options.m_topologies) {
+                                                // waiter, Chandy-Misra and banquet tables are defined for the ring only
+                                                if ("ring" != topology && (tables > 1 || (Fork_policies::back_off != policy && Fork_policies::ordered != policy))) {
+                                                    continue;
+                                                }
+
+                                                for (Interval_profile const& workload : options.m_workloads) {
+                                                    Canteen_config config;
+                                                    config.m_number_of_philosophers = seats;
+                                                    config.m_fork_policy = policy;
+                                                    config.m_execution_mode = mode;
+                                                    config.m_number_of_workers = options.m_number_of_workers;
+                                                    config.m_layout = layout;
+                                                    config.m_affinity = affinity;
+                                                    config.m_is_starvation_enabled = starvation;
+                                                    config.m_workload.m_thinking = workload;
+                                                    config.m_workload.m_eating = workload;
+                                                    config.m_workload.m_hot_seats = options.m_hot_seats;
+                                                    config.m_workload.m_hot_factor = options.m_hot_factor;
+
+                                                    if ("ring" != topology) {
+                                                        config.m_p_topology = std::make_shared<Topology const>(Topology::from_string(topology, seats, options.m_seed));
+                                                        config.m_number_of_philosophers = config.m_p_topology->number_of_seats();
+                                                    }
+
+                                                    std::cout << separator;
+                                                    bench::run(std::cout, config, tables, interval, work, options);
+                                                    std::cout << std::flush;
+                                                    separator = ",\n";
+                                                }
+                                            }
+                                        }
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        std::cout << "\n]}" << std::endl;
+        return 0;
+    } catch (std::exception const& exc) {
+        std::cerr << "Unhandled std::exception: " << exc.what() << std::endl;
+    } catch (...) {
+        std::cerr << "Unhandled unknown exception" << std::endl;
+    }
+
+    return EXIT_FAILURE;
+}
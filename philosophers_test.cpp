@@ -0,0 +1,1053 @@
+#include "canteen.hpp"
+#include "fan_out.hpp"
+#include "metrics.hpp"
+#include "monitor.hpp"
+#include "statistics.hpp"
+#include "topology.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace philosophers {
+namespace test {
+
+/// @throw std::runtime_error if _condition is false
+void
+check(bool _condition, std::string const& _what)
+{
+    if (!_condition) {
+        throw std::runtime_error("Check failed: " + _what);
+    }
+}
+
+/// @brief file of the test case in TMPDIR, removed by destructor
+class Temporary_file
+{
+public:
+    explicit
+        Temporary_file(std::string const& _name)
+        : m_path((std::getenv("TMPDIR") ? std::getenv("TMPDIR") : "/tmp") + std::string("/philosophers_test_")
+                 + std::to_string(::getpid()) + "_" + _name)
+    {}
+
+    ~Temporary_file()
+    {
+        std::remove(this->m_path.c_str());
+    }
+
+    std::string const&
+        path()const
+    {
+        return this->m_path;
+    }
+
+private:
+    std::string const m_path;
+};
+
+/// @brief philosopher changing its state by hand, so producers of tests log numbered events
+class Test_philosopher
+    : public Philosopher
+{
+public:
+    Test_philosopher(unsigned _id, Fork& _fork, Clock const& _clock, Philosopher_counters& _counters)
+        : Philosopher(_id, _id, _fork, _fork, _clock, _counters)
+    {}
+
+    using Philosopher::set_state;
+};
+
+/// @brief monitor keeping every consumed event
+class Recording_monitor
+    : public Monitor
+{
+public:
+    explicit
+        Recording_monitor(Log_queue_config const& _log_queue = Log_queue_config())
+        : Monitor(_log_queue)
+    {}
+
+    log_queue_type const&
+        events()const
+    {
+        return this->m_events;
+    }
+
+protected:
+    void
+        events_logger(log_queue_type const& work_log)override
+    {
+        this->m_events.insert(this->m_events.end(), work_log.cbegin(), work_log.cend());
+    }
+
+private:
+    log_queue_type m_events;
+};
+
+static unsigned const number_of_fork_users = 4;
+
+/// @brief users take forks of a small set by try and by deadline-bounded waits, never two of them hold a fork at once
+void
+fork_exclusion()
+{
+    static unsigned const number_of_forks = 3;
+    std::uint32_t const meals_per_user = 100000;
+    std::deque<Fork> forks;
+    std::atomic<unsigned> holders[number_of_forks];
+    // written only by the holder of the fork, lost increments show a shared fork
+    std::uint64_t meals[number_of_forks] = {};
+    std::atomic<bool> is_shared(false);
+    Stop_token const stop_token;
+
+    for (unsigned i = 0; i < number_of_forks; ++i) {
+        forks.emplace_back(i);
+        holders[i].store(0);
+    }
+
+    std::vector<std::thread> users;
+
+    for (unsigned user = 0; user < number_of_fork_users; ++user) {
+        users.emplace_back([&, user]() {
+            for (std::uint32_t i = 0; i < meals_per_user; ++i) {
+                unsigned const index = (user + i / 2) % number_of_forks;
+                Fork& fork = forks[index];
+
+                if (0 != i % 2 || !fork.try_to_get()) {
+                    while (!fork.wait_until_available(std::chrono::steady_clock::now() + std::chrono::microseconds(100), stop_token)) {
+                    }
+                }
+
+                if (0 != holders[index].fetch_add(1)) {
+                    is_shared.store(true);
+                }
+
+                ++meals[index];
+
+                // the others queue up meanwhile even on a single CPU
+                if (0 == i % 64) {
+                    std::this_thread::yield();
+                }
+
+                holders[index].fetch_sub(1);
+                fork.free();
+            }
+        });
+    }
+
+    for (auto& user : users) {
+        user.join();
+    }
+
+    check(!is_shared.load(), "fork is held by one user at a time");
+    check(number_of_fork_users * meals_per_user == std::accumulate(meals, meals + number_of_forks, std::uint64_t(0)), "every meal is counted");
+
+    for (Fork& fork : forks) {
+        check(fork.try_to_get(), "forks are free at the end");
+    }
+}
+
+/// @brief waiters leave on stop request or deadline racing with the release of the fork, which is never lost or shared
+void
+fork_cancellation()
+{
+    Fork fork(0);
+    std::atomic<unsigned> holders(0);
+    std::atomic<bool> is_shared(false);
+    std::atomic<unsigned> number_of_meals(0);
+
+    for (unsigned round = 0; round < 2000; ++round) {
+        check(fork.try_to_get(), "fork is free between rounds");
+        std::deque<Stop_token> stop_tokens(number_of_fork_users);
+        std::vector<std::thread> waiters;
+
+        for (unsigned waiter = 0; waiter < number_of_fork_users; ++waiter) {
+            waiters.emplace_back([&, waiter]() {
+                // even waiters leave only on stop request, odd ones on a short deadline
+                std::chrono::steady_clock::time_point const deadline = std::chrono::steady_clock::now()
+                        + (0 == waiter % 2 ? std::chrono::microseconds(std::chrono::hours(1)) : std::chrono::microseconds(50 * waiter));
+
+                if (fork.wait_until_available(deadline, stop_tokens[waiter])) {
+                    if (0 != holders.fetch_add(1)) {
+                        is_shared.store(true);
+                    }
+
+                    number_of_meals.fetch_add(1);
+                    holders.fetch_sub(1);
+                    fork.free();
+                }
+            });
+        }
+
+        if (0 != round % 2) {
+            std::this_thread::yield();
+        }
+
+        stop_tokens[0].request_stop();
+        fork.free();
+        stop_tokens[2].request_stop();
+        fork.interrupt();
+
+        for (auto& waiter : waiters) {
+            waiter.join();
+        }
+    }
+
+    check(!is_shared.load(), "fork is held by one waiter at a time");
+    check(0 < number_of_meals.load(), "waiters get the released fork");
+    check(fork.try_to_get(), "fork is free after the last round");
+}
+
+static unsigned const number_of_producers = 4;
+static std::uint32_t const elements_per_producer = 50000;
+
+/// @brief value of Ring_queue tests, producer in high half, its running number in low one
+inline std::uint64_t
+element(unsigned _producer, std::uint32_t _number)
+{
+    return std::uint64_t(_producer) << 32 | _number;
+}
+
+/// @brief several producers and single consumer alternating single and bulk pops through a small ring
+void
+ring_queue()
+{
+    Ring_queue<std::uint64_t> ring(100);
+    check(128 == ring.capacity(), "capacity is rounded up to power of 2");
+    check(ring.empty() && 0 == ring.size(), "new ring is empty");
+    std::vector<std::thread> producers;
+
+    for (unsigned producer = 0; producer < number_of_producers; ++producer) {
+        producers.emplace_back([&ring, producer]() {
+            for (std::uint32_t i = 0; i < elements_per_producer; ++i) {
+                while (!ring.try_push(element(producer, i))) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::vector<std::uint32_t> next(number_of_producers, 0);
+    std::uint64_t bulk[16];
+    std::size_t consumed = 0;
+
+    while (consumed < number_of_producers * elements_per_producer) {
+        std::size_t const number = consumed % 2 ? ring.try_pop_bulk(bulk, sizeof bulk / sizeof bulk[0]) : ring.try_pop(bulk[0]);
+
+        if (0 == number) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        for (std::size_t i = 0; i < number; ++i) {
+            unsigned const producer = unsigned(bulk[i] >> 32);
+            check(producer < number_of_producers, "known producer");
+            check(std::uint32_t(bulk[i]) == next[producer]++, "elements of producer are popped once in push order");
+        }
+
+        consumed += number;
+    }
+
+    for (auto& thread : producers) {
+        thread.join();
+    }
+
+    std::uint64_t value;
+    check(!ring.try_pop(value) && ring.empty(), "ring is empty after all elements are popped");
+}
+
+/// @brief producers also pop, like drop-oldest overflow, so several threads race for the head
+void
+ring_queue_multiple_consumers()
+{
+    Ring_queue<std::uint64_t> ring(64);
+    std::atomic<std::size_t> consumed(0);
+    std::size_t const total = number_of_producers * elements_per_producer;
+    std::vector<std::vector<std::uint64_t>> popped(number_of_producers + 1);
+    std::vector<std::thread> threads;
+
+    for (unsigned producer = 0; producer < number_of_producers; ++producer) {
+        threads.emplace_back([&ring, &consumed, &popped, producer]() {
+            for (std::uint32_t i = 0; i < elements_per_producer; ++i) {
+                std::uint64_t oldest;
+
+                while (!ring.try_push(element(producer, i))) {
+                    if (ring.try_pop(oldest)) {
+                        popped[producer].push_back(oldest);
+                        consumed.fetch_add(1);
+                    }
+                }
+            }
+        });
+    }
+
+    threads.emplace_back([&ring, &consumed, &popped, total]() {
+        std::uint64_t bulk[16];
+
+        while (consumed.load() < total) {
+            std::size_t const number = ring.try_pop_bulk(bulk, sizeof bulk / sizeof bulk[0]);
+            popped[number_of_producers].insert(popped[number_of_producers].end(), bulk, bulk + number);
+            consumed.fetch_add(number);
+
+            if (0 == number) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<std::uint64_t> all;
+
+    for (auto const& values : popped) {
+        std::vector<std::uint32_t> last(number_of_producers, 0);
+        std::vector<bool> is_seen(number_of_producers, false);
+
+        for (std::uint64_t const value : values) {
+            unsigned const producer = unsigned(value >> 32);
+            check(producer < number_of_producers, "known producer");
+            check(!is_seen[producer] || last[producer] < std::uint32_t(value), "every consumer pops elements of producer in push order");
+            is_seen[producer] = true;
+            last[producer] = std::uint32_t(value);
+        }
+
+        all.insert(all.end(), values.cbegin(), values.cend());
+    }
+
+    std::sort(all.begin(), all.end());
+    check(total == all.size(), "every element is popped");
+    check(all.end() == std::adjacent_find(all.begin(), all.end()), "no element is popped twice");
+}
+
+/// @brief producers log through a tiny queue of _config, consumer runs monitor_worker()
+///
+/// Sequence numbers of a seat should grow by one without losses and keep growing otherwise.
+/// Every event is either consumed or counted as dropped.
+void
+monitor_overflow(Log_queue_config _config, bool _is_lossless)
+{
+    _config.m_capacity = 64;
+    Recording_monitor monitor(_config);
+    Steady_clock const clock;
+    std::deque<Fork> forks;
+    Counters_table counters(number_of_producers);
+
+    for (unsigned i = 0; i < number_of_producers; ++i) {
+        forks.emplace_back(i);
+    }
+
+    std::thread consumer(&Monitor::monitor_worker, &monitor);
+    std::vector<std::thread> producers;
+
+    for (unsigned producer = 0; producer < number_of_producers; ++producer) {
+        producers.emplace_back([&monitor, &forks, &clock, &counters, producer]() {
+            Test_philosopher philosopher(producer, forks[producer], clock, counters[producer]);
+
+            for (std::uint32_t i = 0; i < elements_per_producer; ++i) {
+                philosopher.set_state(i % 2 ? Philosopher::States::thinks : Philosopher::States::hungry);
+                monitor.log_state(philosopher);
+            }
+        });
+    }
+
+    for (auto& thread : producers) {
+        thread.join();
+    }
+
+    monitor.request_stop();
+    consumer.join();
+    // events left after the consumer stopped
+    monitor.drain();
+
+    std::vector<std::uint32_t> last(number_of_producers, 0);
+
+    for (auto const& el : monitor.events()) {
+        check(el.m_id < number_of_producers, "known seat");
+        check(_is_lossless ? last[el.m_id] + 1 == el.m_sequence : last[el.m_id] < el.m_sequence, "events of seat are consumed in order");
+        last[el.m_id] = el.m_sequence;
+    }
+
+    std::uint64_t const total = number_of_producers * elements_per_producer;
+    check(total == monitor.events().size() + monitor.dropped(), "every event is consumed or dropped");
+    check(!_is_lossless || 0 == monitor.dropped(), "no events are dropped");
+}
+
+void
+monitor_block()
+{
+    monitor_overflow(Log_queue_config(), true);
+}
+
+void
+monitor_drop()
+{
+    Log_queue_config config;
+    config.m_overflow_policy = Overflow_policies::drop;
+    monitor_overflow(config, false);
+}
+
+void
+monitor_drop_oldest()
+{
+    Log_queue_config config;
+    config.m_overflow_policy = Overflow_policies::drop_oldest;
+    monitor_overflow(config, false);
+}
+
+void
+monitor_mutex()
+{
+    Log_queue_config config;
+    config.m_queue = Log_queues::mutex;
+    monitor_overflow(config, true);
+}
+
+/// @brief percentiles of known values are off by less than the relative error of log-linear buckets
+void
+histogram_percentiles()
+{
+    Histogram small;
+
+    for (std::uint64_t value = 0; value < 16; ++value) {
+        small.add(value);
+    }
+
+    check(7 == small.percentile(0.5) && 15 == small.percentile(1.), "values below sub-buckets are exact");
+
+    Histogram histogram;
+    std::uint64_t const number_of_values = 100000;
+
+    for (std::uint64_t value = 1; value <= number_of_values; ++value) {
+        histogram.add(value);
+    }
+
+    check(number_of_values == histogram.count(), "count");
+    check(number_of_values * (number_of_values + 1) / 2 == histogram.sum(), "sum");
+    check(number_of_values == histogram.max(), "max");
+
+    for (double const fraction : {0.01, 0.5, 0.9, 0.99, 0.999}) {
+        double const expected = fraction * double(number_of_values);
+        double const error = std::abs(double(histogram.percentile(fraction)) - expected) / expected;
+        check(error < 1. / 16., "percentile " + std::to_string(fraction));
+    }
+
+    check(number_of_values == histogram.percentile(1.), "percentile 1 is bounded by max");
+}
+
+/// @brief reader takes snapshots on another thread while the single writer adds values
+void
+histogram_concurrent_reads()
+{
+    Histogram histogram;
+    std::uint64_t const max_value = 1000;
+    std::uint64_t const number_of_values = 1000000;
+    std::atomic<bool> is_written(false);
+
+    std::thread writer([&histogram, &is_written, max_value, number_of_values]() {
+        for (std::uint64_t i = 0; i < number_of_values; ++i) {
+            histogram.add(1 + i % max_value);
+        }
+
+        is_written.store(true);
+    });
+
+    std::uint64_t last_count = 0;
+
+    do {
+        std::uint64_t const count = histogram.count();
+        check(last_count <= count, "count never decreases");
+        last_count = count;
+
+        for (double const fraction : {0.5, 0.99}) {
+            check(histogram.percentile(fraction) <= max_value, "percentile is bounded by written values");
+        }
+
+        check(histogram.mean() <= double(max_value), "mean is bounded by written values");
+    } while (!is_written.load());
+
+    writer.join();
+    check(number_of_values == histogram.count(), "all values are counted");
+    check(max_value == histogram.max(), "max");
+}
+
+/// @brief stop of healthy threads and pool runs with starvation enabled is not reported as deaths
+void
+no_deaths_on_stop()
+{
+    // philosophers die after 200 ms without meal, a few ms of contention of 5 seats never get close
+    set_intervals(50, Interval_units::ms, Work_modes::sleep);
+
+    for (Execution_modes const mode : {Execution_modes::threads, Execution_modes::pool}) {
+        Statistics_monitor monitor;
+        Canteen_config config;
+        config.m_number_of_philosophers = 5;
+        config.m_execution_mode = mode;
+        config.m_is_starvation_enabled = true;
+        {
+            Canteen canteen(monitor, config);
+            canteen.run_for(std::chrono::seconds(1));
+        }
+
+        check(0 < monitor.meals(), std::string("philosophers ate in ") + to_string(mode) + " mode");
+        check(0 == monitor.deaths(), std::string("no deaths in ") + to_string(mode) + " mode, "
+              + std::to_string(monitor.deaths()) + " reported, max hunger fraction " + std::to_string(monitor.max_hunger_fraction()));
+    }
+}
+
+/// @brief scrape after a healthy run is stopped exports no deaths
+void
+metrics_after_stop()
+{
+    set_intervals(50, Interval_units::ms, Work_modes::sleep);
+    Statistics_monitor monitor;
+    Canteen_config config;
+    config.m_number_of_philosophers = 5;
+    config.m_is_starvation_enabled = true;
+    Canteen canteen(monitor, config);
+    Metrics_server const server(0, monitor, &monitor);
+    canteen.run_for(std::chrono::seconds(1));
+    std::string const metrics = server.render();
+    check(std::string::npos != metrics.find("\nphilosophers_deaths_total 0\n"), "no deaths are exported");
+    check(std::string::npos != metrics.find("\nphilosophers_hunger_seconds_count "), "hunger histogram is exported");
+}
+
+/// @brief sink of Fan_out_monitor recording when seating and the end of the run arrive, consume could be held at a gate
+class Sink_monitor
+    : public Recording_monitor
+{
+public:
+    Sink_monitor()
+        : m_is_gate_closed(false)
+        , m_is_waiting_at_gate(false)
+        , m_events_before_seating(~std::size_t(0))
+        , m_events_before_finish(~std::size_t(0))
+    {}
+
+    void
+        set_seating(Seating const&)override
+    {
+        this->m_events_before_seating = events().size();
+    }
+
+    void
+        close_gate()
+    {
+        std::lock_guard<std::mutex> lock(this->m_mutex);
+        this->m_is_gate_closed = true;
+    }
+
+    void
+        open_gate()
+    {
+        {
+            std::lock_guard<std::mutex> lock(this->m_mutex);
+            this->m_is_gate_closed = false;
+        }
+        this->m_event.notify_all();
+    }
+
+    /// @brief wait until the sink consumer is held at the closed gate
+    void
+        wait_at_gate()
+    {
+        std::unique_lock<std::mutex> lock(this->m_mutex);
+        this->m_event.wait(lock, [this]() {
+            return this->m_is_waiting_at_gate;
+        });
+    }
+
+    /// @brief ~0 - no seating or end of the run yet
+    std::size_t
+        events_before_seating()const
+    {
+        return this->m_events_before_seating;
+    }
+
+    std::size_t
+        events_before_finish()const
+    {
+        return this->m_events_before_finish;
+    }
+
+protected:
+    void
+        events_logger(log_queue_type const& work_log)override
+    {
+        {
+            std::unique_lock<std::mutex> lock(this->m_mutex);
+            this->m_is_waiting_at_gate = this->m_is_gate_closed;
+            this->m_event.notify_all();
+            this->m_event.wait(lock, [this]() {
+                return !this->m_is_gate_closed;
+            });
+            this->m_is_waiting_at_gate = false;
+        }
+        Recording_monitor::events_logger(work_log);
+    }
+
+    void
+        events_finished()override
+    {
+        this->m_events_before_finish = events().size();
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_event;
+    bool m_is_gate_closed;
+    bool m_is_waiting_at_gate;
+    std::size_t m_events_before_seating;
+    std::size_t m_events_before_finish;
+};
+
+/// @brief batch of _size events numbered from _first, every event of its own seat
+Monitor::log_queue_type
+numbered_batch(std::uint32_t _first, std::size_t _size)
+{
+    Monitor::log_queue_type result;
+
+    for (std::uint32_t i = _first; i < _first + _size; ++i) {
+        result.emplace_back(Clock::time_point(std::chrono::microseconds(i)), i % 5, Philosopher::States::thinks, std::uint16_t(i));
+    }
+
+    return result;
+}
+
+/// @brief batches of events numbered from 0 are consumed by the sink in order, unless dropped as whole batches
+void
+check_batches(Monitor::log_queue_type const& _events, std::size_t _batch_size, std::string const& _sink)
+{
+    check(0 == _events.size() % _batch_size, _sink + " consumes whole batches");
+
+    for (std::size_t i = 0; i < _events.size(); ++i) {
+        std::uint16_t const sequence = _events[i].m_sequence;
+        check(0 == i % _batch_size ? 0 == sequence % _batch_size : _events[i - 1].m_sequence + 1 == sequence, _sink + " consumes whole batches");
+        check(0 == i || _events[i - 1].m_sequence < sequence, _sink + " consumes batches in order");
+    }
+}
+
+/// @brief slow sink drops batches without holding up the other one, inline drain is lossless, finish() follows all batches
+void
+fan_out()
+{
+    std::size_t const batch_size = 10;
+    unsigned const queue_capacity = 2;
+    std::vector<std::unique_ptr<Monitor>> sinks;
+    sinks.emplace_back(new Sink_monitor());
+    sinks.emplace_back(new Sink_monitor());
+    Fan_out_monitor monitor(std::move(sinks), Log_queue_config(), queue_capacity);
+    Sink_monitor& fast = static_cast<Sink_monitor&>(monitor.sink(0));
+    Sink_monitor& slow = static_cast<Sink_monitor&>(monitor.sink(1));
+    monitor.set_seating(Seating());
+    slow.close_gate();
+    monitor.consume(numbered_batch(0, batch_size));
+    slow.wait_at_gate();
+    std::uint32_t const number_of_batches = 20;
+
+    // held sink has one batch in hand, queue_capacity queued, the rest of them are dropped
+    for (std::uint32_t i = 1; i < number_of_batches; ++i) {
+        monitor.consume(numbered_batch(i * batch_size, batch_size));
+    }
+
+    check(number_of_batches - 1 - queue_capacity == monitor.dropped_batches(1), "batches dropped for full queue of slow sink");
+    slow.open_gate();
+    monitor.wait_until_consumed();
+    check((1 + queue_capacity) * batch_size == slow.events().size(), "slow sink consumes batches it got");
+    check(number_of_batches * batch_size == fast.events().size() + monitor.dropped_batches(0) * batch_size,
+          "every batch is consumed by fast sink or counted as dropped");
+    std::size_t const fast_events = fast.events().size();
+
+    // inline drain waits for space in the queue of the held sink instead of dropping
+    monitor.set_drained_inline(true);
+    slow.close_gate();
+    std::thread producer([&monitor, number_of_batches, batch_size]() {
+        for (std::uint32_t i = number_of_batches; i < 2 * number_of_batches; ++i) {
+            monitor.consume(numbered_batch(i * batch_size, batch_size));
+        }
+
+        monitor.finish();
+    });
+    slow.wait_at_gate();
+    slow.open_gate();
+    producer.join();
+    monitor.wait_until_consumed();
+    check(number_of_batches - 1 - queue_capacity == monitor.dropped_batches(1), "inline drain drops no batches");
+    check((1 + queue_capacity + number_of_batches) * batch_size == slow.events().size(), "inline drain is lossless");
+    check(fast_events + number_of_batches * batch_size == fast.events().size(), "inline drain is lossless for fast sink");
+
+    for (Sink_monitor const* const p_sink : {&fast, &slow}) {
+        std::string const name = p_sink == &fast ? "fast sink" : "slow sink";
+        check(0 == p_sink->events_before_seating(), name + " gets seating before the first batch");
+        check(p_sink->events().size() == p_sink->events_before_finish(), name + " finishes after the last batch");
+        check_batches(p_sink->events(), batch_size, name);
+    }
+}
+
+/// @brief events of State_log_element are equal field by field
+bool
+is_equal(State_log_element const& _left, State_log_element const& _right)
+{
+    return _left.m_time == _right.m_time && _left.m_id == _right.m_id
+           && _left.m_state == _right.m_state && _left.m_sequence == _right.m_sequence;
+}
+
+/// @brief events written by Trace_monitor are read back and replayed unchanged, file grows past its preallocation
+void
+trace_round_trip()
+{
+    Temporary_file const file("trace_round_trip.trace");
+    Seating seating;
+    seating.m_fork_policy = Fork_policies::ordered;
+    seating.m_forks = {{0, 1}, {1, 2}, {0, 2}};
+    Monitor::log_queue_type written;
+    {
+        Trace_monitor monitor(file.path());
+        monitor.set_seating(seating);
+        Monitor::log_queue_type batch;
+
+        // 100000 records of 24 bytes need the 1 MiB mapping to grow
+        for (std::uint32_t i = 0; i < 100000; ++i) {
+            batch.emplace_back(Clock::time_point(std::chrono::microseconds(i / 3)), i % 3, Philosopher::States(i % 3), std::uint16_t(i / 3 + 1));
+
+            if (1000 == batch.size()) {
+                monitor.consume(batch);
+                written.insert(written.end(), batch.cbegin(), batch.cend());
+                batch.clear();
+            }
+        }
+    }
+
+    Trace_reader const reader(file.path());
+    check(written.size() == reader.header().m_number_of_records, "number of records");
+    check(3 == reader.header().m_number_of_seats, "number of seats");
+    check(Fork_policies::ordered == Fork_policies(reader.header().m_fork_policy), "fork policy");
+    check(seating.m_forks == reader.seating().m_forks, "forks of seats");
+
+    for (std::size_t i = 0; i < written.size(); ++i) {
+        trace::Record const& record = reader.begin()[i];
+        check(written[i].m_id == record.m_seat && seating.m_forks[record.m_seat].first == record.m_left_fork
+              && seating.m_forks[record.m_seat].second == record.m_right_fork, "seat and forks of record " + std::to_string(i));
+    }
+
+    Recording_monitor replayed;
+    reader.replay(replayed);
+    check(written.size() == replayed.events().size(), "every record is replayed");
+
+    for (std::size_t i = 0; i < written.size(); ++i) {
+        check(is_equal(written[i], replayed.events()[i]), "replayed event " + std::to_string(i));
+    }
+
+    check(!replayed.is_drained_inline(), "replay restores drain mode of the monitor");
+}
+
+/// @brief simulation replayed from the recorded schedule of its own trace logs the recorded events
+///
+/// Intervals in progress when the recording stopped are unknown, so the replay may add events after the recorded ones.
+void
+replay_round_trip()
+{
+    Temporary_file const file("replay_round_trip.trace");
+    set_intervals(20, Interval_units::ms, Work_modes::sleep);
+    g_seed = 1;
+    Canteen_config config;
+    config.m_number_of_philosophers = 7;
+    config.m_fork_policy = Fork_policies::ordered;
+    config.m_execution_mode = Execution_modes::simulation;
+    {
+        Trace_monitor monitor(file.path());
+        Canteen canteen(monitor, config);
+        canteen.run_for(std::chrono::seconds(5));
+    }
+
+    Trace_reader const reader(file.path());
+    std::size_t const number_of_records = std::size_t(reader.header().m_number_of_records);
+    check(0 < number_of_records, "simulation is recorded");
+    config.m_p_script = std::make_shared<Schedule_script const>(reader.script());
+    // the script, not random intervals, should reproduce the run
+    g_seed = 2;
+    Recording_monitor replayed;
+    {
+        Canteen canteen(replayed, config);
+        canteen.run_for(std::chrono::seconds(5));
+    }
+
+    check(number_of_records <= replayed.events().size(), "every recorded event is replayed");
+
+    for (std::size_t i = 0; i < replayed.events().size(); ++i) {
+        trace::Record const& record = reader.begin()[std::min(i, number_of_records - 1)];
+        Clock::time_point const time(std::chrono::duration_cast<Clock::time_point::duration>(std::chrono::nanoseconds(record.m_time_ns)));
+
+        if (i < number_of_records) {
+            State_log_element const recorded(time, record.m_seat, Philosopher::States(record.m_state), record.m_sequence);
+            check(is_equal(recorded, replayed.events()[i]), "replayed event " + std::to_string(i));
+        } else {
+            check(time < replayed.events()[i].m_time, "events after the script follow the recorded ones");
+        }
+    }
+}
+
+/// @brief seats added after and removed at random places of a running ring, _is_done is set when the canteen stops
+void
+resize_randomly(Canteen& _canteen, std::atomic<bool>& _is_done, unsigned& _number_of_changes)
+{
+    std::default_random_engine random_engine(1);
+
+    try {
+        while (!_is_done.load()) {
+            std::vector<unsigned> const seats = _canteen.seats();
+            unsigned const seat = seats[std::uniform_int_distribution<std::size_t>(0, seats.size() - 1)(random_engine)];
+
+            if (seats.size() < 4 || (seats.size() < 12 && 0 == random_engine() % 2)) {
+                _canteen.add_seat(seat);
+            } else {
+                _canteen.remove_seat(seat);
+            }
+
+            ++_number_of_changes;
+        }
+    } catch (std::runtime_error const&) {
+        // canteen is stopped while a neighbour is paused
+    }
+}
+
+/// @brief threads ring resized while it runs stops on time and the trace knows forks of every seat
+void
+resize_seats()
+{
+    Temporary_file const file("resize_seats.trace");
+    Canteen_config config;
+    config.m_number_of_philosophers = 5;
+    config.m_fork_policy = Fork_policies::ordered;
+    config.m_is_starvation_enabled = false;
+    // every change waits for a pause of a neighbour, 2 s of 2 ms intervals make a few thousand of them
+    config.m_seat_capacity = 100000;
+    set_intervals(2, Interval_units::ms, Work_modes::sleep);
+    unsigned number_of_changes = 0;
+    {
+        Trace_monitor monitor(file.path());
+        Canteen canteen(monitor, config);
+        std::atomic<bool> is_done(false);
+        std::thread resizer(resize_randomly, std::ref(canteen), std::ref(is_done), std::ref(number_of_changes));
+        canteen.run_for(std::chrono::seconds(2));
+        is_done.store(true);
+        resizer.join();
+    }
+
+    check(10 < number_of_changes, "seats are added and removed, " + std::to_string(number_of_changes) + " changes");
+    Trace_reader const reader(file.path());
+
+    for (std::size_t i = 0; i < reader.header().m_number_of_records; ++i) {
+        trace::Record const& record = reader.begin()[i];
+        check(~0u != record.m_left_fork && ~0u != record.m_right_fork && record.m_left_fork != record.m_right_fork,
+              "forks of seat " + std::to_string(record.m_seat) + " are known");
+    }
+
+    // pause of a neighbour waits for its next thinking, that could be a whole second away
+    set_intervals(1000, Interval_units::ms, Work_modes::sleep);
+    Statistics_monitor monitor;
+    Canteen canteen(monitor, config);
+    std::atomic<bool> is_done(false);
+    number_of_changes = 0;
+    std::thread resizer(resize_randomly, std::ref(canteen), std::ref(is_done), std::ref(number_of_changes));
+    steady_clock::time_point const start = steady_clock::now();
+    canteen.run_for(std::chrono::seconds(1));
+    steady_clock::duration const run_time = steady_clock::now() - start;
+    is_done.store(true);
+    resizer.join();
+    check(run_time < std::chrono::milliseconds(1500), "stop is not held up by a paused neighbour");
+}
+
+/// @brief forks of _seat in ascending order
+std::vector<unsigned>
+forks_of(Topology const& _topology, unsigned _seat)
+{
+    return std::vector<unsigned>(_topology.forks().cbegin() + std::ptrdiff_t(_topology.offset(_seat)),
+                                 _topology.forks().cbegin() + std::ptrdiff_t(_topology.offset(_seat + 1)));
+}
+
+/// @return true if _function throws std::invalid_argument
+template<typename Function>
+bool
+is_rejected(Function _function)
+{
+    try {
+        _function();
+    } catch (std::invalid_argument const&) {
+        return true;
+    }
+
+    return false;
+}
+
+/// @brief specs of every topology and their errors
+void
+topology_from_string()
+{
+    Topology const ring = Topology::from_string("ring", 5, 1);
+    check(Topologies::ring == ring.kind() && 5 == ring.number_of_seats() && 5 == ring.number_of_forks() && 10 == ring.number_of_edges(), "ring");
+    check((std::vector<unsigned>{0, 4}) == forks_of(ring, 4), "last seat of ring takes forks 4 and 0");
+
+    Topology const torus = Topology::from_string("torus:4", 12, 1);
+    check(Topologies::torus == torus.kind() && 12 == torus.number_of_seats() && 24 == torus.number_of_forks() && 48 == torus.number_of_edges(), "torus 4x3");
+    // seat 0 takes west edge 3, east edge 0, north edge 12 + 8 and south edge 12
+    check((std::vector<unsigned>{0, 3, 12, 20}) == forks_of(torus, 0), "forks of torus seat 0");
+    std::vector<unsigned> users(torus.number_of_forks(), 0);
+
+    for (unsigned const fork : torus.forks()) {
+        ++users[fork];
+    }
+
+    check(std::all_of(users.cbegin(), users.cend(), [](unsigned _users) {
+        return 2 == _users;
+    }), "every torus edge is shared by 2 seats");
+
+    Topology const random = Topology::from_string("random:10:3", 20, 7);
+    check(20 == random.number_of_seats() && 10 == random.number_of_forks() && 60 == random.number_of_edges(), "random 3 of 10 forks");
+
+    for (unsigned seat = 0; seat < random.number_of_seats(); ++seat) {
+        std::vector<unsigned> const forks = forks_of(random, seat);
+        check(std::is_sorted(forks.cbegin(), forks.cend()) && forks.cend() == std::adjacent_find(forks.cbegin(), forks.cend())
+              && forks.back() < 10, "distinct sorted forks of random seat " + std::to_string(seat));
+    }
+
+    check(random.forks() == Topology::from_string("random:10:3", 20, 7).forks(), "random topology is reproducible for seed");
+    check(2 * 20 == Topology::from_string("random:10", 20, 7).number_of_edges(), "random seats take 2 forks by default");
+
+    check(is_rejected([]() { Topology::from_string("star", 4, 1); }), "unknown topology");
+    check(is_rejected([]() { Topology::from_string("torus:5", 12, 1); }), "torus width not dividing seats");
+    check(is_rejected([]() { Topology::from_string("torus:12", 12, 1); }), "torus of 1 row");
+    check(is_rejected([]() { Topology::from_string("random:2:3", 4, 1); }), "more forks per seat than forks");
+    check(is_rejected([]() { Topology::from_string("file:/nonexistent/topology", 4, 1); }), "missing file");
+}
+
+/// @brief seats of topology file, comments, blank lines, duplicates and errors
+void
+topology_load()
+{
+    Temporary_file const file("topology_load.txt");
+    {
+        std::ofstream out(file.path());
+        out << "# seats of a triangle\n"
+            << "0 1\n"
+            << "\n"
+            << "1 2 # second seat\n"
+            << "2 0 2\n";
+    }
+
+    Topology const topology = Topology::from_string("file:" + file.path(), 0, 1);
+    check(Topologies::file == topology.kind() && 3 == topology.number_of_seats() && 3 == topology.number_of_forks(), "triangle of 3 seats");
+    check((std::vector<unsigned>{0, 2}) == forks_of(topology, 2), "duplicated fork is taken once");
+    check(6 == topology.number_of_edges(), "edges of triangle");
+
+    {
+        std::ofstream out(file.path());
+        out << "0 1\n"
+            << "1 x\n";
+    }
+
+    check(is_rejected([&file]() { Topology::load(file.path()); }), "invalid fork id");
+
+    for (char const* const line : {"1 -1", "1 4294967295", "1 16777216", "1 99999999999999999999", "3", "2 2"}) {
+        {
+            std::ofstream out(file.path());
+            out << "0 1\n"
+                << line << "\n";
+        }
+
+        check(is_rejected([&file]() { Topology::load(file.path()); }), std::string("rejected seat ") + line);
+    }
+
+    {
+        std::ofstream out(file.path());
+        out << "0 16777215\n";
+    }
+
+    check(16777216 == Topology::load(file.path()).number_of_forks(), "largest fork id");
+}
+
+struct Test_case
+{
+    char const* m_name;
+    void (*m_function)();
+};
+
+static Test_case const test_cases[] = {
+    {"fork_exclusion", fork_exclusion},
+    {"fork_cancellation", fork_cancellation},
+    {"ring_queue", ring_queue},
+    {"ring_queue_multiple_consumers", ring_queue_multiple_consumers},
+    {"monitor_block", monitor_block},
+    {"monitor_drop", monitor_drop},
+    {"monitor_drop_oldest", monitor_drop_oldest},
+    {"monitor_mutex", monitor_mutex},
+    {"histogram_percentiles", histogram_percentiles},
+    {"histogram_concurrent_reads", histogram_concurrent_reads},
+    {"no_deaths_on_stop", no_deaths_on_stop},
+    {"fan_out", fan_out},
+    {"metrics_after_stop", metrics_after_stop},
+    {"trace_round_trip", trace_round_trip},
+    {"replay_round_trip", replay_round_trip},
+    {"resize_seats", resize_seats},
+    {"topology_from_string", topology_from_string},
+    {"topology_load", topology_load},
+};
+
+}  // namespace test
+}  // namespace philosophers
+
+/// @brief run test cases named by arguments, all of them without arguments
+int
+main(int argc, char* argv[])
+{
+    using namespace philosophers::test;
+    int result = 0;
+    int number_of_runs = 0;
+
+    for (auto const& test_case : test_cases) {
+        if (argc > 1 && argv + argc == std::find_if(argv + 1, argv + argc, [&test_case](char const* _arg) {
+            return 0 == std::strcmp(_arg, test_case.m_name);
+        })) {
+            continue;
+        }
+
+        ++number_of_runs;
+
+        try {
+            test_case.m_function();
+            std::cout << "Passed " << test_case.m_name << std::endl;
+        } catch (std::exception const& exc) {
+            std::cerr << "Failed " << test_case.m_name << ": " << exc.what() << std::endl;
+            result = EXIT_FAILURE;
+        }
+    }
+
+    if (0 == number_of_runs) {
+        std::cerr << "Unknown test cases" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return result;
+}
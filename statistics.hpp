@@ -0,0 +1,449 @@
+#ifndef PHILOSOPHERS_STATISTICS_HPP_
+#define PHILOSOPHERS_STATISTICS_HPP_
+
+#include "monitor.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace philosophers {
+
+/// @brief fixed-size log-linear histogram of non-negative values
+///
+/// Every power of 2 is split into sub_buckets linear buckets, so relative error is below 1 / sub_buckets.
+/// Values below sub_buckets are counted exactly.
+/// Single writer updates relaxed atomics without read-modify-write, so readers on other threads
+/// (periodic summaries, metrics endpoints) take snapshots without locks.
+class Histogram
+{
+    static unsigned const sub_bucket_bits = 4;
+    static unsigned const sub_buckets = 1u << sub_bucket_bits;
+
+public:
+    static unsigned const number_of_buckets = sub_buckets + (64 - sub_bucket_bits) * sub_buckets;
+
+    Histogram()
+        : m_count(0)
+        , m_sum(0)
+        , m_max(0)
+    {
+        for (auto& bucket : this->m_buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    Histogram(Histogram const&) = delete;
+    Histogram& operator=(Histogram const&) = delete;
+
+    /// @brief called by the single writer only
+    void
+        add(std::uint64_t _value)
+    {
+        increment(this->m_buckets[index(_value)], 1);
+        increment(this->m_count, 1);
+        increment(this->m_sum, _value);
+
+        if (this->m_max.load(std::memory_order_relaxed) < _value) {
+            this->m_max.store(_value, std::memory_order_relaxed);
+        }
+    }
+
+    std::uint64_t
+        count()const
+    {
+        return this->m_count.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t
+        sum()const
+    {
+        return this->m_sum.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t
+        max()const
+    {
+        return this->m_max.load(std::memory_order_relaxed);
+    }
+
+    double
+        mean()const
+    {
+        std::uint64_t const count = this->count();
+        return count ? double(this->sum()) / double(count) : 0.;
+    }
+
+    /// @param _fraction in [0, 1]
+    /// @return middle of the bucket containing the value
+    std::uint64_t
+        percentile(double _fraction)const
+    {
+        std::uint64_t const rank = std::uint64_t(_fraction * double(this->count()) + 0.5);
+        std::uint64_t accumulated = 0;
+
+        for (unsigned i = 0; i < number_of_buckets; ++i) {
+            accumulated += bucket(i);
+
+            if (accumulated != 0 && rank <= accumulated) {
+                return std::min(this->max(), (lower_bound(i) + upper_bound(i)) / 2);
+            }
+        }
+
+        return this->max();
+    }
+
+    std::uint64_t
+        bucket(unsigned _index)const
+    {
+        return this->m_buckets[_index].load(std::memory_order_relaxed);
+    }
+
+    static std::uint64_t
+        lower_bound(unsigned _index)
+    {
+        if (_index < sub_buckets) {
+            return _index;
+        }
+
+        unsigned const exponent = (_index - sub_buckets) / sub_buckets + sub_bucket_bits;
+        std::uint64_t const sub_bucket = (_index - sub_buckets) % sub_buckets;
+        return (sub_buckets + sub_bucket) << (exponent - sub_bucket_bits);
+    }
+
+    /// @return exclusive upper bound
+    static std::uint64_t
+        upper_bound(unsigned _index)
+    {
+        return _index + 1 < number_of_buckets ? lower_bound(_index + 1) : ~std::uint64_t(0);
+    }
+
+private:
+    static unsigned
+        index(std::uint64_t _value)
+    {
+        if (_value < sub_buckets) {
+            return unsigned(_value);
+        }
+
+        unsigned const exponent = 63 - unsigned(__builtin_clzll(_value));
+        unsigned const sub_bucket = unsigned(_value >> (exponent - sub_bucket_bits)) & (sub_buckets - 1);
+        return sub_buckets + (exponent - sub_bucket_bits) * sub_buckets + sub_bucket;
+    }
+
+    static void
+        increment(std::atomic<std::uint64_t>& _counter, std::uint64_t _value)
+    {
+        _counter.store(_counter.load(std::memory_order_relaxed) + _value, std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<std::uint64_t>, number_of_buckets> m_buckets;
+    std::atomic<std::uint64_t> m_count;
+    std::atomic<std::uint64_t> m_sum;
+    std::atomic<std::uint64_t> m_max;
+};
+
+/// @brief online statistics of events without per-event allocation
+///
+/// Per-seat meals, distributions of thinking, hungry and dining durations and deaths computed from events timestamps.
+/// Starvation near-misses are meals reached after hunger of at least near_miss_fraction of the death interval.
+/// Histograms, deaths and near-misses could be read from other threads, e.g. by Metrics_server.
+class Statistics_monitor
+    : public Monitor
+{
+    struct Seat
+    {
+        Seat()
+            : m_meals(0)
+            , m_state(Philosopher::States::dead)
+            , m_since()
+            , m_is_removed(false)
+        {}
+
+        std::uint64_t m_meals;
+        /// last known state, dead - no event yet
+        Philosopher::States m_state;
+        Clock::time_point m_since;
+        /// taken out of a resized ring, its meals are not weighed by fairness()
+        bool m_is_removed;
+    };
+
+public:
+    static double constexpr near_miss_fraction = 0.8;
+
+    explicit
+        Statistics_monitor(Log_queue_config const& _log_queue = Log_queue_config())
+        : Monitor(_log_queue)
+        , m_deaths(0)
+        , m_near_misses(0)
+        , m_max_hunger_fraction(0.)
+    {}
+
+    void
+        set_seating(Seating const& _seating) override
+    {
+        this->m_seats.resize(std::max(this->m_seats.size(), _seating.m_forks.size()));
+
+        for (unsigned const seat : _seating.m_removed_seats) {
+            this->m_seats[seat].m_is_removed = true;
+        }
+    }
+
+    std::uint64_t
+        meals()const
+    {
+        std::uint64_t result = 0;
+
+        for (auto const& seat : this->m_seats) {
+            result += seat.m_meals;
+        }
+
+        return result;
+    }
+
+    std::uint64_t
+        meals(unsigned _seat)const
+    {
+        return this->m_seats[_seat].m_meals;
+    }
+
+    std::uint64_t
+        deaths()const
+    {
+        return this->m_deaths.load(std::memory_order_relaxed);
+    }
+
+    /// @brief Jain's fairness index of meals per seat still at the table, 1 - all seats ate equally
+    double
+        fairness()const
+    {
+        double sum = 0.;
+        double sum_of_squares = 0.;
+        std::size_t number_of_seats = 0;
+
+        for (auto const& seat : this->m_seats) {
+            if (!seat.m_is_removed) {
+                sum += double(seat.m_meals);
+                sum_of_squares += double(seat.m_meals) * double(seat.m_meals);
+                ++number_of_seats;
+            }
+        }
+
+        return sum_of_squares > 0. ? sum * sum / (double(number_of_seats) * sum_of_squares) : 1.;
+    }
+
+    /// @brief hungry to dines latency in ns
+    Histogram const&
+        hunger()const
+    {
+        return this->m_hunger;
+    }
+
+    /// @brief thinking durations in ns
+    Histogram const&
+        thinking()const
+    {
+        return this->m_thinking;
+    }
+
+    /// @brief dining durations in ns
+    Histogram const&
+        dining()const
+    {
+        return this->m_dining;
+    }
+
+    /// @brief meals after hunger of at least near_miss_fraction of Starvation::death_interval()
+    std::uint64_t
+        near_misses()const
+    {
+        return this->m_near_misses.load(std::memory_order_relaxed);
+    }
+
+    /// @brief longest hunger ended by a meal as a fraction of Starvation::death_interval()
+    double
+        max_hunger_fraction()const
+    {
+        return this->m_max_hunger_fraction;
+    }
+
+protected:
+    void
+        events_logger(log_queue_type const& work_log)override
+    {
+        for (auto const& el : work_log) {
+            if (this->m_seats.size() <= el.m_id) {
+                this->m_seats.resize(el.m_id + 1);
+            }
+
+            Seat& seat = this->m_seats[el.m_id];
+            std::uint64_t const duration = std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(el.m_time - seat.m_since).count());
+
+            switch (seat.m_state) {
+            case Philosopher::States::thinks:
+                this->m_thinking.add(duration);
+                break;
+
+            case Philosopher::States::hungry:
+                if (Philosopher::States::dines == el.m_state) {
+                    this->m_hunger.add(duration);
+                    near_miss(duration);
+                }
+
+                break;
+
+            case Philosopher::States::dines:
+                this->m_dining.add(duration);
+                break;
+
+            default:
+                break;
+            }
+
+            switch (el.m_state) {
+            case Philosopher::States::dines:
+                ++seat.m_meals;
+                break;
+
+            case Philosopher::States::dead:
+                this->m_deaths.store(this->m_deaths.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                break;
+
+            default:
+                break;
+            }
+
+            seat.m_state = el.m_state;
+            seat.m_since = el.m_time;
+        }
+    }
+
+private:
+    void
+        near_miss(std::uint64_t _hunger_ns)
+    {
+        double const fraction = double(_hunger_ns) / double(Starvation::death_interval().count());
+        this->m_max_hunger_fraction = std::max(this->m_max_hunger_fraction, fraction);
+
+        if (fraction >= near_miss_fraction) {
+            this->m_near_misses.store(this->m_near_misses.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    }
+
+    std::vector<Seat> m_seats;
+    Histogram m_thinking;
+    Histogram m_hunger;
+    Histogram m_dining;
+    /// written by the single consumer
+    std::atomic<std::uint64_t> m_deaths;
+    std::atomic<std::uint64_t> m_near_misses;
+    double m_max_hunger_fraction;
+};
+
+/// @brief ns value with the largest unit keeping it at least 1
+inline std::string
+duration_string(std::uint64_t _ns)
+{
+    char buffer[32];
+
+    if (_ns < 1000) {
+        std::snprintf(buffer, sizeof buffer, "%lluns", static_cast<unsigned long long>(_ns));
+    } else if (_ns < 1000000) {
+        std::snprintf(buffer, sizeof buffer, "%.1fus", double(_ns) / 1e3);
+    } else if (_ns < 1000000000) {
+        std::snprintf(buffer, sizeof buffer, "%.1fms", double(_ns) / 1e6);
+    } else {
+        std::snprintf(buffer, sizeof buffer, "%.2fs", double(_ns) / 1e9);
+    }
+
+    return buffer;
+}
+
+/// @brief Statistics_monitor printing one summary line per interval of events time instead of a line per event
+///
+/// Intervals follow timestamps of events, so simulation is summarized per simulated interval.
+class Summary_monitor
+    : public Statistics_monitor
+{
+public:
+    Summary_monitor(std::ostream& _out, std::chrono::seconds _interval, Log_queue_config const& _log_queue = Log_queue_config())
+        : Statistics_monitor(_log_queue)
+        , m_out(_out)
+        , m_interval(std::max(std::chrono::seconds(1), _interval))
+        , m_start()
+        , m_next_summary()
+        , m_is_started(false)
+        , m_last_meals(0)
+    {}
+
+    /// @brief summary of everything consumed so far, _elapsed since the first event
+    void
+        print_summary(Clock::time_point::duration _elapsed)
+    {
+        std::uint64_t const meals = this->meals();
+        double const seconds = std::chrono::duration<double>(_elapsed).count();
+        char line[512];
+        std::snprintf(line, sizeof line,
+                      "[%8.1fs] meals %llu (+%llu) fairness %.4f deaths %llu near-misses %llu (max %.2f)"
+                      " | hungry p50 %s p99 %s p999 %s max %s | thinking p50 %s | dining p50 %s",
+                      seconds,
+                      static_cast<unsigned long long>(meals),
+                      static_cast<unsigned long long>(meals - this->m_last_meals),
+                      this->fairness(),
+                      static_cast<unsigned long long>(this->deaths()),
+                      static_cast<unsigned long long>(this->near_misses()),
+                      this->max_hunger_fraction(),
+                      duration_string(this->hunger().percentile(0.5)).c_str(),
+                      duration_string(this->hunger().percentile(0.99)).c_str(),
+                      duration_string(this->hunger().percentile(0.999)).c_str(),
+                      duration_string(this->hunger().max()).c_str(),
+                      duration_string(this->thinking().percentile(0.5)).c_str(),
+                      duration_string(this->dining().percentile(0.5)).c_str());
+        this->m_out << line << std::endl;
+        this->m_last_meals = meals;
+    }
+
+protected:
+    void
+        events_logger(log_queue_type const& work_log)override
+    {
+        if (work_log.empty()) {
+            return;
+        }
+
+        if (!this->m_is_started) {
+            this->m_start = work_log.front().m_time;
+            this->m_next_summary = this->m_start + this->m_interval;
+            this->m_is_started = true;
+        }
+
+        Statistics_monitor::events_logger(work_log);
+        Clock::time_point const last = work_log.back().m_time;
+
+        if (last >= this->m_next_summary) {
+            print_summary(last - this->m_start);
+
+            while (this->m_next_summary <= last) {
+                this->m_next_summary += this->m_interval;
+            }
+        }
+    }
+
+private:
+    std::ostream& m_out;
+    std::chrono::seconds const m_interval;
+    Clock::time_point m_start;
+    Clock::time_point m_next_summary;
+    bool m_is_started;
+    std::uint64_t m_last_meals;
+};
+
+}  // namespace philosophers
+
+#endif  // PHILOSOPHERS_STATISTICS_HPP_
@@ -0,0 +1,484 @@
+#ifndef PHILOSOPHERS_TEXT_MONITORS_HPP_
+#define PHILOSOPHERS_TEXT_MONITORS_HPP_
+
+#include "monitor.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace philosophers {
+
+enum class Waterfall_modes
+{
+    /// one line of all seats per frame
+    lines,
+    /// table redrawn in place on terminal, only changed cells are written
+    screen
+};
+
+inline char const*
+to_string(Waterfall_modes _mode)
+{
+    switch (_mode) {
+    case Waterfall_modes::lines:
+        return "lines";
+
+    case Waterfall_modes::screen:
+        return "screen";
+
+    default:
+        return "?????";
+    }
+}
+
+inline Waterfall_modes
+waterfall_mode_from_string(std::string const& _name)
+{
+    for (auto const mode : {Waterfall_modes::lines, Waterfall_modes::screen}) {
+        if (_name == to_string(mode)) {
+            return mode;
+        }
+    }
+
+    throw std::invalid_argument("Unknown waterfall mode: " + _name);
+}
+
+/// @brief text output settings of monitors
+struct Output_config
+{
+    Output_config()
+        : m_frame_interval(0)
+        , m_waterfall_mode(Waterfall_modes::lines)
+        , m_frames_per_second(0)
+    {}
+
+    /// minimal interval between writes to stdout, 0 - write every drained batch
+    std::chrono::milliseconds m_frame_interval;
+    Waterfall_modes m_waterfall_mode;
+    /// Waterfall_monitor coalesces updates into frames, 0 - frame per drained batch
+    unsigned m_frames_per_second;
+};
+
+/// @brief preallocated text buffer written to stdout by single fwrite
+class Output_buffer
+{
+public:
+    explicit
+        Output_buffer(Output_config const& _config, std::size_t _capacity = 1u << 16)
+        : m_config(_config)
+        , m_last_write(steady_clock::now())
+    {
+        this->m_buffer.reserve(_capacity);
+    }
+
+    ~Output_buffer()
+    {
+        write();
+    }
+
+    void
+        append(char const* _str, std::size_t _size)
+    {
+        this->m_buffer.append(_str, _size);
+    }
+
+    void
+        append(std::string const& _str)
+    {
+        this->m_buffer.append(_str);
+    }
+
+    void
+        append(char _c)
+    {
+        this->m_buffer.push_back(_c);
+    }
+
+    /// @brief make room for at most _max_size characters written in place
+    /// @return position to write to, end of written text is passed to end_append()
+    char*
+        begin_append(std::size_t _max_size)
+    {
+        std::size_t const size = this->m_buffer.size();
+        this->m_buffer.resize(size + _max_size);
+        return &this->m_buffer[size];
+    }
+
+    void
+        end_append(char const* _p_end)
+    {
+        this->m_buffer.resize(std::size_t(_p_end - this->m_buffer.data()));
+    }
+
+    /// @brief write buffer if frame interval elapsed since the previous write
+    void
+        end_of_frame()
+    {
+        if (this->m_config.m_frame_interval == std::chrono::milliseconds(0)) {
+            write();
+            return;
+        }
+
+        steady_clock::time_point const now = steady_clock::now();
+
+        if (this->m_config.m_frame_interval <= now - this->m_last_write) {
+            this->m_last_write = now;
+            write();
+        }
+    }
+
+    void
+        write()
+    {
+        if (this->m_buffer.empty()) {
+            return;
+        }
+
+        std::fwrite(this->m_buffer.data(), 1, this->m_buffer.size(), stdout);
+        std::fflush(stdout);
+        // keeps capacity
+        this->m_buffer.clear();
+    }
+
+private:
+    Output_config const m_config;
+    steady_clock::time_point m_last_write;
+    std::string m_buffer;
+};
+
+/// @brief text of events formatted in place with precomputed strings of states
+///
+/// Decimal numbers are written two digits at a time from a lookup table,
+/// so formatting does not allocate or branch on state.
+class Event_formatter
+{
+public:
+    /// @brief longest line written by format()
+    static std::size_t const max_line_size = 13 + 10 + 8;
+
+    /// @brief write "Philosopher #<id> <state>\n" at _p_out
+    /// @return end of written text
+    static char*
+        format(char* _p_out, State_log_element const& _element)
+    {
+        std::memcpy(_p_out, "Philosopher #", 13);
+        _p_out = format_decimal(_p_out + 13, _element.m_id);
+        State_text const& text = state_text(_element.m_state);
+        // every text is padded to 8 characters, only its size is accounted
+        std::memcpy(_p_out, text.m_text, 8);
+        return _p_out + text.m_size;
+    }
+
+    static char*
+        format_decimal(char* _p_out, std::uint32_t _value)
+    {
+        static char const digits[] =
+            "00010203040506070809"
+            "10111213141516171819"
+            "20212223242526272829"
+            "30313233343536373839"
+            "40414243444546474849"
+            "50515253545556575859"
+            "60616263646566676869"
+            "70717273747576777879"
+            "80818283848586878889"
+            "90919293949596979899";
+        char buffer[10];
+        char* p_begin = buffer + sizeof buffer;
+
+        while (_value >= 100) {
+            unsigned const pair = 2 * (_value % 100);
+            _value /= 100;
+            *--p_begin = digits[pair + 1];
+            *--p_begin = digits[pair];
+        }
+
+        if (_value >= 10) {
+            *--p_begin = digits[2 * _value + 1];
+            *--p_begin = digits[2 * _value];
+        } else {
+            *--p_begin = char('0' + _value);
+        }
+
+        std::size_t const size = std::size_t(buffer + sizeof buffer - p_begin);
+        std::memcpy(_p_out, p_begin, size);
+        return _p_out + size;
+    }
+
+private:
+    struct State_text
+    {
+        char m_text[9];
+        std::size_t m_size;
+    };
+
+    static State_text const&
+        state_text(Philosopher::States _state)
+    {
+        static State_text const texts[] = {
+            {" thinks\n", 8},
+            {" hungry\n", 8},
+            {" dines\n", 7},
+            {" die\n", 5},
+            {" ?????\n", 7}
+        };
+        std::size_t const index = std::size_t(_state);
+        return texts[std::min(index, sizeof texts / sizeof texts[0] - 1)];
+    }
+};
+
+class Simple_log_monitor
+    : public Monitor
+{
+public:
+    explicit
+        Simple_log_monitor(Log_queue_config const& _log_queue = Log_queue_config(), Output_config const& _output = Output_config())
+        : Monitor(_log_queue)
+        , m_output(_output)
+    {}
+
+protected:
+    void
+        events_logger(log_queue_type const& work_log) override
+    {
+        char* p_out = this->m_output.begin_append(work_log.size() * Event_formatter::max_line_size);
+
+        for (auto const& el : work_log) {
+            p_out = Event_formatter::format(p_out, el);
+        }
+
+        this->m_output.end_append(p_out);
+        this->m_output.end_of_frame();
+    }
+
+    void
+        events_finished() override
+    {
+        this->m_output.write();
+    }
+
+private:
+    Output_buffer m_output;
+};
+
+class Waterfall_monitor
+    : public Monitor
+{
+public:
+    explicit
+        Waterfall_monitor(Log_queue_config const& _log_queue = Log_queue_config(), Output_config const& _output = Output_config())
+        : Monitor(_log_queue)
+        , m_mode(_output.m_waterfall_mode)
+        , m_frame_period(_output.m_frames_per_second
+                         ? std::chrono::duration_cast<steady_clock::duration>(std::chrono::seconds(1)) / _output.m_frames_per_second
+                         : steady_clock::duration::zero())
+        , m_next_frame(steady_clock::now())
+        , m_width(terminal_width())
+        , m_is_screen_cleared(false)
+        , m_output(_output)
+    {}
+
+    /// @brief cells of seats removed from a resized ring are blanked, their late events are not shown
+    void
+        set_seating(Seating const& _seating)override
+    {
+        this->m_removed_seats = _seating.m_removed_seats;
+
+        for (unsigned const seat : this->m_removed_seats) {
+            update(seat, ' ');
+        }
+    }
+
+protected:
+    void
+        events_logger(log_queue_type const& work_log)override
+    {
+        auto const log_event = [this](log_queue_type::value_type const & el) {
+            if (this->m_removed_seats.empty() || !std::binary_search(this->m_removed_seats.cbegin(), this->m_removed_seats.cend(), el.m_id)) {
+                update(el.m_id, symb(el.m_state));
+            }
+        };
+        std::for_each(std::begin(work_log), std::end(work_log), log_event);
+
+        if (this->m_frame_period != steady_clock::duration::zero()) {
+            steady_clock::time_point const now = steady_clock::now();
+
+            if (now < this->m_next_frame) {
+                // coalesced into the next frame
+                return;
+            }
+
+            this->m_next_frame = now + this->m_frame_period;
+        }
+
+        render_frame();
+        this->m_output.end_of_frame();
+    }
+
+    /// @brief changes coalesced since the last frame are rendered when the run stops
+    void
+        events_finished()override
+    {
+        if (!this->m_changed.empty()) {
+            render_frame();
+        }
+
+        this->m_output.write();
+    }
+
+private:
+    void
+        render_frame()
+    {
+        if (Waterfall_modes::screen == this->m_mode) {
+            render_changes();
+        } else {
+            this->m_output.append(this->m_buffer);
+            this->m_output.append('\n');
+            clear_changes();
+        }
+    }
+
+    void
+        update(unsigned _seat, char _symbol)
+    {
+        if (this->m_buffer.size() <= _seat) {
+            this->m_buffer.append(_seat + 1 - this->m_buffer.size(), symb(Philosopher::States::thinks));
+            this->m_is_changed.resize(this->m_buffer.size(), false);
+        }
+
+        if (this->m_buffer[_seat] == _symbol) {
+            return;
+        }
+
+        this->m_buffer[_seat] = _symbol;
+
+        if (!this->m_is_changed[_seat]) {
+            this->m_is_changed[_seat] = true;
+            this->m_changed.push_back(_seat);
+        }
+    }
+
+    void
+        clear_changes()
+    {
+        for (unsigned const seat : this->m_changed) {
+            this->m_is_changed[seat] = false;
+        }
+
+        this->m_changed.clear();
+    }
+
+    /// @brief write only changed runs of cells, table is wrapped by terminal width
+    void
+        render_changes()
+    {
+        if (!this->m_is_screen_cleared) {
+            this->m_is_screen_cleared = true;
+            static char const clear_screen[] = "\x1b[H\x1b[2J";
+            this->m_output.append(clear_screen, sizeof clear_screen - 1);
+            clear_changes();
+
+            for (unsigned seat = 0; seat < this->m_buffer.size(); ++seat) {
+                this->m_is_changed[seat] = true;
+                this->m_changed.push_back(seat);
+            }
+        }
+
+        if (this->m_changed.empty()) {
+            return;
+        }
+
+        std::sort(this->m_changed.begin(), this->m_changed.end());
+
+        for (auto p_first = this->m_changed.cbegin(); p_first != this->m_changed.cend();) {
+            auto p_last = p_first;
+
+            // extend run while the next changed cell is adjacent in the same row
+            while (p_last + 1 != this->m_changed.cend() && *(p_last + 1) == *p_last + 1 && (*p_last + 1) % this->m_width != 0) {
+                ++p_last;
+            }
+
+            move_cursor(*p_first / this->m_width + 1, *p_first % this->m_width + 1);
+            this->m_output.append(this->m_buffer.data() + *p_first, *p_last - *p_first + 1);
+            p_first = p_last + 1;
+        }
+
+        clear_changes();
+        // park cursor below the table
+        move_cursor(unsigned(this->m_buffer.size() + this->m_width - 1) / this->m_width + 1, 1);
+    }
+
+    void
+        move_cursor(unsigned _row, unsigned _column)
+    {
+        char sequence[32];
+        int const size = std::snprintf(sequence, sizeof sequence, "\x1b[%u;%uH", _row, _column);
+        this->m_output.append(sequence, std::size_t(size));
+    }
+
+    static unsigned
+        terminal_width()
+    {
+        struct winsize size;
+
+        if (isatty(STDOUT_FILENO) && 0 == ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) && 0 < size.ws_col) {
+            return size.ws_col;
+        }
+
+        return 80;
+    }
+
+    static char
+        symb(Philosopher::States _state)
+    {
+        switch (_state) {
+        case Philosopher::States::thinks:
+            return ' ';
+            break;
+
+        case Philosopher::States::hungry:
+            return '.';
+            break;
+
+        case Philosopher::States::dines:
+            return '|';
+            break;
+
+        case Philosopher::States::dead:
+            return '#';
+            break;
+
+        default:
+            return '?';
+            break;
+        }
+    }
+
+    Waterfall_modes const m_mode;
+    steady_clock::duration const m_frame_period;
+    steady_clock::time_point m_next_frame;
+    unsigned const m_width;
+    bool m_is_screen_cleared;
+    std::string m_buffer;
+    /// seats changed since the previous frame
+    std::vector<bool> m_is_changed;
+    std::vector<unsigned> m_changed;
+    /// ascending ids of seats removed from a resized ring
+    std::vector<unsigned> m_removed_seats;
+    Output_buffer m_output;
+};
+
+}  // namespace philosophers
+
+#endif  // PHILOSOPHERS_TEXT_MONITORS_HPP_
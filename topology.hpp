@@ -0,0 +1,293 @@
+#ifndef PHILOSOPHERS_TOPOLOGY_HPP_
+#define PHILOSOPHERS_TOPOLOGY_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace philosophers {
+
+/// @brief graph of seats and the forks every seat needs to dine
+enum class Topologies
+{
+    /// seat i takes forks i and i + 1, the classic table
+    ring,
+    /// seats on a 2D torus, forks are its edges, so every seat takes 4 forks shared with 4 neighbours
+    torus,
+    /// every seat takes the same number of distinct forks picked uniformly
+    random,
+    /// fork sets of seats are loaded from a file
+    file
+};
+
+inline char const*
+to_string(Topologies _topology)
+{
+    switch (_topology) {
+    case Topologies::ring:
+        return "ring";
+
+    case Topologies::torus:
+        return "torus";
+
+    case Topologies::random:
+        return "random";
+
+    case Topologies::file:
+        return "file";
+
+    default:
+        return "?????";
+    }
+}
+
+inline Topologies
+topology_from_string(std::string const& _name)
+{
+    for (auto const topology : {Topologies::ring, Topologies::torus, Topologies::random, Topologies::file}) {
+        if (_name == to_string(topology)) {
+            return topology;
+        }
+    }
+
+    throw std::invalid_argument("Unknown topology: " + _name);
+}
+
+/// @brief fork sets of all seats in ascending fork id order
+///
+/// Sets are stored flat with offsets of seats (compressed sparse rows),
+/// so a graph of millions of edges takes two arrays and no allocation per seat.
+class Topology
+{
+public:
+    /// @brief bound of fork ids of topology files, forks of a table are allocated up front
+    static constexpr unsigned max_number_of_forks = 1u << 24;
+
+    static Topology
+        ring(unsigned _number_of_seats)
+    {
+        Topology result(Topologies::ring, _number_of_seats);
+
+        for (unsigned i = 0; i < _number_of_seats; ++i) {
+            result.add_seat({i, (i + 1) % _number_of_seats});
+        }
+
+        return result;
+    }
+
+    /// @brief _width x _height seats, horizontal edges are forks 0..w*h-1, vertical ones follow
+    static Topology
+        torus(unsigned _width, unsigned _height)
+    {
+        if (_width < 2 || _height < 2) {
+            throw std::invalid_argument("Torus should be at least 2x2");
+        }
+
+        unsigned const size = _width * _height;
+        Topology result(Topologies::torus, 2 * size);
+
+        for (unsigned y = 0; y < _height; ++y) {
+            for (unsigned x = 0; x < _width; ++x) {
+                unsigned const west = y * _width + (x + _width - 1) % _width;
+                unsigned const north = size + (y + _height - 1) % _height * _width + x;
+                result.add_seat({west, y * _width + x, north, size + y * _width + x});
+            }
+        }
+
+        result.m_name = "torus " + std::to_string(_width) + "x" + std::to_string(_height);
+        return result;
+    }
+
+    /// @brief every seat takes _forks_per_seat distinct forks of _number_of_forks, reproducible for _seed
+    static Topology
+        random(unsigned _number_of_seats, unsigned _number_of_forks, unsigned _forks_per_seat, unsigned _seed)
+    {
+        if (0 == _forks_per_seat || _number_of_forks < _forks_per_seat) {
+            throw std::invalid_argument("Random topology needs 1 to number of forks forks per seat");
+        }
+
+        Topology result(Topologies::random, _number_of_forks);
+        std::default_random_engine random_engine(_seed);
+        std::uniform_int_distribution<unsigned> distribution(0, _number_of_forks - 1);
+        std::vector<unsigned> forks;
+
+        for (unsigned i = 0; i < _number_of_seats; ++i) {
+            forks.clear();
+
+            while (forks.size() < _forks_per_seat) {
+                unsigned const fork = distribution(random_engine);
+
+                if (std::find(forks.cbegin(), forks.cend(), fork) == forks.cend()) {
+                    forks.push_back(fork);
+                }
+            }
+
+            result.add_seat(forks);
+        }
+
+        result.m_name = "random " + std::to_string(_forks_per_seat) + " of " + std::to_string(_number_of_forks) + " forks";
+        return result;
+    }
+
+    /// @brief line per seat with its fork ids separated by spaces, `#` starts a comment, blank lines are skipped
+    static Topology
+        load(std::string const& _path)
+    {
+        std::ifstream file(_path);
+
+        if (!file) {
+            throw std::invalid_argument("Can not open topology file: " + _path);
+        }
+
+        Topology result(Topologies::file, 0);
+        std::string line;
+        std::vector<unsigned> forks;
+
+        while (std::getline(file, line)) {
+            std::istringstream stream(line.substr(0, line.find('#')));
+            forks.clear();
+            // wider than fork ids, so negative and too large ids are read as such instead of wrapping
+            long long fork;
+
+            while (stream >> fork) {
+                if (fork < 0 || fork >= max_number_of_forks) {
+                    throw std::invalid_argument("Fork id of topology file should be 0 to "
+                                                + std::to_string(max_number_of_forks - 1) + ": " + line);
+                }
+
+                forks.push_back(unsigned(fork));
+                result.m_number_of_forks = std::max(result.m_number_of_forks, unsigned(fork) + 1);
+            }
+
+            if (!stream.eof()) {
+                throw std::invalid_argument("Invalid line of topology file: " + line);
+            }
+
+            if (forks.empty()) {
+                continue;
+            }
+
+            if (std::count(forks.cbegin(), forks.cend(), forks.front()) == std::ptrdiff_t(forks.size())) {
+                throw std::invalid_argument("Seat of topology file should take at least 2 distinct forks: " + line);
+            }
+
+            result.add_seat(forks);
+        }
+
+        result.m_name = "file " + _path;
+        return result;
+    }
+
+    /// @brief `ring`, `torus:<width>`, `random:<forks>:<forks_per_seat>` or `file:<path>`
+    /// @param _number_of_seats ignored by file topology, it defines seats itself
+    static Topology
+        from_string(std::string const& _spec, unsigned _number_of_seats, unsigned _seed)
+    {
+        std::string::size_type const colon = _spec.find(':');
+        std::string const parameters = colon == std::string::npos ? std::string() : _spec.substr(colon + 1);
+        char* p_end = nullptr;
+
+        switch (topology_from_string(_spec.substr(0, colon))) {
+        case Topologies::torus: {
+            unsigned const width = unsigned(std::strtoul(parameters.c_str(), nullptr, 10));
+
+            if (0 == width || 0 != _number_of_seats % width) {
+                throw std::invalid_argument("Torus width should divide the number of seats: " + _spec);
+            }
+
+            return torus(width, _number_of_seats / width);
+        }
+
+        case Topologies::random: {
+            unsigned const number_of_forks = unsigned(std::strtoul(parameters.c_str(), &p_end, 10));
+            unsigned const forks_per_seat = ':' == *p_end ? unsigned(std::strtoul(p_end + 1, nullptr, 10)) : 2;
+            return random(_number_of_seats, number_of_forks, forks_per_seat, _seed);
+        }
+
+        case Topologies::file:
+            return load(parameters);
+
+        default:
+            return ring(_number_of_seats);
+        }
+    }
+
+    Topologies
+        kind()const
+    {
+        return this->m_kind;
+    }
+
+    unsigned
+        number_of_seats()const
+    {
+        return unsigned(this->m_offsets.size() - 1);
+    }
+
+    unsigned
+        number_of_forks()const
+    {
+        return this->m_number_of_forks;
+    }
+
+    /// @brief seat-fork pairs
+    std::size_t
+        number_of_edges()const
+    {
+        return this->m_forks.size();
+    }
+
+    /// @brief offset of the first fork of _seat in forks(), the seat ends at offset of the next one
+    std::size_t
+        offset(unsigned _seat)const
+    {
+        return this->m_offsets[_seat];
+    }
+
+    /// @brief fork sets of all seats laid one after another
+    std::vector<unsigned> const&
+        forks()const
+    {
+        return this->m_forks;
+    }
+
+    std::string const&
+        name()const
+    {
+        return this->m_name;
+    }
+
+private:
+    Topology(Topologies _kind, unsigned _number_of_forks)
+        : m_kind(_kind)
+        , m_name(to_string(_kind))
+        , m_number_of_forks(_number_of_forks)
+        , m_offsets(1, 0)
+    {}
+
+    /// @brief duplicated forks of the seat are taken once
+    void
+        add_seat(std::vector<unsigned> _forks)
+    {
+        std::sort(_forks.begin(), _forks.end());
+        _forks.erase(std::unique(_forks.begin(), _forks.end()), _forks.end());
+        this->m_forks.insert(this->m_forks.end(), _forks.cbegin(), _forks.cend());
+        this->m_offsets.push_back(this->m_forks.size());
+    }
+
+    Topologies m_kind;
+    std::string m_name;
+    unsigned m_number_of_forks;
+    std::vector<std::size_t> m_offsets;
+    std::vector<unsigned> m_forks;
+};
+
+}  // namespace philosophers
+
+#endif  // PHILOSOPHERS_TOPOLOGY_HPP_
@@ -0,0 +1,358 @@
+#ifndef PHILOSOPHERS_TRACE_HPP_
+#define PHILOSOPHERS_TRACE_HPP_
+
+#include "monitor.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace philosophers {
+
+/// @brief binary trace file layout, host byte order
+namespace trace {
+
+static std::uint32_t const version = 1;
+static char const magic[8] = {'P', 'H', 'I', 'L', 'T', 'R', 'C', '\0'};
+
+struct Header
+{
+    char m_magic[8];
+    std::uint32_t m_version;
+    std::uint32_t m_header_size;
+    std::uint32_t m_record_size;
+    std::uint32_t m_number_of_seats;
+    /// truncated, 0 for sub-millisecond intervals
+    std::uint32_t m_max_interval_ms;
+    std::uint32_t m_fork_policy;
+    /// updated after every drained batch, so a killed run is still readable
+    std::uint64_t m_number_of_records;
+    char m_git_describe[64];
+};
+
+struct Record
+{
+    /// clock of the run (steady or virtual) in ns
+    std::int64_t m_time_ns;
+    std::uint32_t m_seat;
+    std::uint32_t m_left_fork;
+    std::uint32_t m_right_fork;
+    std::uint8_t m_state;
+    std::uint8_t m_reserved;
+    /// State_log_element::m_sequence, 0 in traces written before it was recorded
+    std::uint16_t m_sequence;
+};
+
+}  // namespace trace
+
+/// @brief preallocated memory mapped file, doubled when full and truncated to used size on close
+class Mapped_file_writer
+{
+public:
+    Mapped_file_writer(std::string const& _path, std::size_t _capacity)
+        : m_fd(::open(_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644))
+        , m_p_data(nullptr)
+        , m_size(0)
+        , m_capacity(0)
+    {
+        if (this->m_fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "Can not open trace file " + _path);
+        }
+
+        remap(_capacity);
+    }
+
+    ~Mapped_file_writer()
+    {
+        ::munmap(this->m_p_data, this->m_capacity);
+
+        if (0 != ::ftruncate(this->m_fd, off_t(this->m_size))) {
+            std::cerr << "Can not truncate trace file" << std::endl;
+        }
+
+        ::close(this->m_fd);
+    }
+
+    /// @return pointer to _size bytes appended at the end
+    char*
+        append(std::size_t _size)
+    {
+        if (this->m_capacity < this->m_size + _size) {
+            std::size_t capacity = this->m_capacity;
+
+            while (capacity < this->m_size + _size) {
+                capacity *= 2;
+            }
+
+            remap(capacity);
+        }
+
+        char* const p_result = this->m_p_data + this->m_size;
+        this->m_size += _size;
+        return p_result;
+    }
+
+    char*
+        data()const
+    {
+        return this->m_p_data;
+    }
+
+private:
+    void
+        remap(std::size_t _capacity)
+    {
+        if (this->m_p_data) {
+            ::munmap(this->m_p_data, this->m_capacity);
+            this->m_p_data = nullptr;
+        }
+
+        if (0 != ::ftruncate(this->m_fd, off_t(_capacity))) {
+            throw std::system_error(errno, std::generic_category(), "Can not grow trace file");
+        }
+
+        void* const p_data = ::mmap(nullptr, _capacity, PROT_READ | PROT_WRITE, MAP_SHARED, this->m_fd, 0);
+
+        if (MAP_FAILED == p_data) {
+            throw std::system_error(errno, std::generic_category(), "Can not map trace file");
+        }
+
+        this->m_p_data = static_cast<char*>(p_data);
+        this->m_capacity = _capacity;
+    }
+
+    int const m_fd;
+    char* m_p_data;
+    std::size_t m_size;
+    std::size_t m_capacity;
+};
+
+/// @brief writes fixed-width binary trace::Record for every event
+class Trace_monitor
+    : public Monitor
+{
+public:
+    explicit
+        Trace_monitor(std::string const& _path, Log_queue_config const& _log_queue = Log_queue_config())
+        : Monitor(_log_queue)
+        , m_file(_path, std::size_t(1) << 20)
+    {
+        trace::Header& header = *reinterpret_cast<trace::Header*>(this->m_file.append(sizeof(trace::Header)));
+        std::memset(&header, 0, sizeof header);
+        std::memcpy(header.m_magic, trace::magic, sizeof header.m_magic);
+        header.m_version = trace::version;
+        header.m_header_size = sizeof(trace::Header);
+        header.m_record_size = sizeof(trace::Record);
+        header.m_max_interval_ms = std::uint32_t(std::chrono::duration_cast<std::chrono::milliseconds>(g_max_interval).count());
+        std::strncpy(header.m_git_describe, GIT_DESCRIBE, sizeof header.m_git_describe - 1);
+    }
+
+    void
+        set_seating(Seating const& _seating) override
+    {
+        this->m_seating = _seating;
+        header().m_number_of_seats = std::uint32_t(_seating.m_forks.size());
+        header().m_fork_policy = std::uint32_t(_seating.m_fork_policy);
+    }
+
+protected:
+    void
+        events_logger(log_queue_type const& work_log)override
+    {
+        trace::Record* p_record = reinterpret_cast<trace::Record*>(this->m_file.append(work_log.size() * sizeof(trace::Record)));
+
+        for (auto const& el : work_log) {
+            p_record->m_time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(el.m_time.time_since_epoch()).count();
+            p_record->m_seat = el.m_id;
+            bool const is_known_seat = el.m_id < this->m_seating.m_forks.size();
+            p_record->m_left_fork = is_known_seat ? this->m_seating.m_forks[el.m_id].first : ~0u;
+            p_record->m_right_fork = is_known_seat ? this->m_seating.m_forks[el.m_id].second : ~0u;
+            p_record->m_state = std::uint8_t(el.m_state);
+            p_record->m_reserved = 0;
+            p_record->m_sequence = el.m_sequence;
+            ++p_record;
+        }
+
+        header().m_number_of_records += work_log.size();
+    }
+
+private:
+    /// @note mapping is moved on growth, so header is never cached
+    trace::Header&
+        header()
+    {
+        return *reinterpret_cast<trace::Header*>(this->m_file.data());
+    }
+
+    Mapped_file_writer m_file;
+    Seating m_seating;
+};
+
+/// @brief read-only memory mapped trace written by Trace_monitor
+class Trace_reader
+{
+public:
+    explicit
+        Trace_reader(std::string const& _path)
+        : m_p_data(nullptr)
+        , m_size(0)
+    {
+        int const fd = ::open(_path.c_str(), O_RDONLY);
+
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "Can not open trace file " + _path);
+        }
+
+        struct stat info;
+
+        if (0 != ::fstat(fd, &info)) {
+            ::close(fd);
+            throw std::system_error(errno, std::generic_category(), "Can not stat trace file " + _path);
+        }
+
+        this->m_size = std::size_t(info.st_size);
+        void* const p_data = this->m_size < sizeof(trace::Header) ? MAP_FAILED : ::mmap(nullptr, this->m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+
+        if (MAP_FAILED == p_data) {
+            throw std::runtime_error("Can not map trace file " + _path);
+        }
+
+        this->m_p_data = static_cast<char const*>(p_data);
+        trace::Header const& header = this->header();
+
+        if (0 != std::memcmp(header.m_magic, trace::magic, sizeof trace::magic) || trace::version != header.m_version ||
+                sizeof(trace::Header) != header.m_header_size || sizeof(trace::Record) != header.m_record_size ||
+                this->m_size < sizeof(trace::Header) + header.m_number_of_records * sizeof(trace::Record)) {
+            ::munmap(const_cast<char*>(this->m_p_data), this->m_size);
+            throw std::runtime_error("Invalid trace file " + _path);
+        }
+    }
+
+    ~Trace_reader()
+    {
+        ::munmap(const_cast<char*>(this->m_p_data), this->m_size);
+    }
+
+    trace::Header const&
+        header()const
+    {
+        return *reinterpret_cast<trace::Header const*>(this->m_p_data);
+    }
+
+    trace::Record const*
+        begin()const
+    {
+        return reinterpret_cast<trace::Record const*>(this->m_p_data + sizeof(trace::Header));
+    }
+
+    trace::Record const*
+        end()const
+    {
+        return begin() + header().m_number_of_records;
+    }
+
+    /// @brief seating of the recorded run, forks of seats are taken from their records
+    Seating
+        seating()const
+    {
+        Seating result;
+        result.m_fork_policy = Fork_policies(header().m_fork_policy);
+        result.m_forks.resize(header().m_number_of_seats);
+
+        for (auto p_record = begin(); p_record != end(); ++p_record) {
+            if (p_record->m_seat < result.m_forks.size()) {
+                result.m_forks[p_record->m_seat] = std::make_pair(p_record->m_left_fork, p_record->m_right_fork);
+            }
+        }
+
+        return result;
+    }
+
+    /// @brief recorded intervals and order of meals at every fork to be replayed by Simulation
+    ///
+    /// Thinking interval is the time from thinks to hungry, dining one from dines to next thinks of the seat.
+    /// Hunger is not scripted, it results from replayed order of meals.
+    Schedule_script
+        script()const
+    {
+        std::uint32_t const number_of_seats = header().m_number_of_seats;
+        Schedule_script result(seating().m_forks);
+        std::vector<trace::Record const*> last(number_of_seats, nullptr);
+
+        // events of a seat are in their order in the file, since every philosopher pushes its own events in order
+        for (auto p_record = begin(); p_record != end(); ++p_record) {
+            if (number_of_seats <= p_record->m_seat) {
+                continue;
+            }
+
+            Philosopher::States const state = Philosopher::States(p_record->m_state);
+            trace::Record const* const p_last = last[p_record->m_seat];
+
+            if (p_last) {
+                Philosopher::States const last_state = Philosopher::States(p_last->m_state);
+
+                if ((Philosopher::States::thinks == last_state && Philosopher::States::hungry == state)
+                        || (Philosopher::States::dines == last_state && Philosopher::States::thinks == state)) {
+                    result.add_interval(p_record->m_seat, std::chrono::nanoseconds(p_record->m_time_ns - p_last->m_time_ns));
+                }
+            }
+
+            if (Philosopher::States::dines == state) {
+                result.add_meal(p_record->m_seat);
+            }
+
+            last[p_record->m_seat] = p_record;
+        }
+
+        return result;
+    }
+
+    /// @brief feed recorded events to monitor, batch per timestamp like drains of Simulation
+    void
+        replay(Monitor& _monitor)const
+    {
+        // nothing runs in real time, so monitor may make replay wait instead of losing events
+        _monitor.set_drained_inline(true);
+        _monitor.set_seating(seating());
+        Monitor::log_queue_type batch;
+
+        for (auto p_record = begin(); p_record != end(); ++p_record) {
+            if (!batch.empty() && batch.back().m_time.time_since_epoch() != std::chrono::nanoseconds(p_record->m_time_ns)) {
+                _monitor.consume(batch);
+                batch.clear();
+            }
+
+            batch.emplace_back(Clock::time_point(std::chrono::duration_cast<Clock::time_point::duration>(std::chrono::nanoseconds(p_record->m_time_ns))),
+                               p_record->m_seat,
+                               Philosopher::States(p_record->m_state),
+                               p_record->m_sequence);
+        }
+
+        if (!batch.empty()) {
+            _monitor.consume(batch);
+        }
+
+        _monitor.finish();
+        _monitor.set_drained_inline(false);
+    }
+
+private:
+    char const* m_p_data;
+    std::size_t m_size;
+};
+
+}  // namespace philosophers
+
+#endif  // PHILOSOPHERS_TRACE_HPP_
@@ -0,0 +1,231 @@
+#ifndef PHILOSOPHERS_WORKLOAD_HPP_
+#define PHILOSOPHERS_WORKLOAD_HPP_
+
+#include "fork.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace philosophers {
+
+/// @brief distribution of random thinking or eating intervals
+enum class Distributions
+{
+    /// multiples of g_interval_unit from 1 unit to g_max_interval
+    uniform,
+    /// always the mean
+    fixed,
+    exponential,
+    /// heavy tail, parameter is shape alpha > 1
+    pareto,
+    /// short intervals and rare ones 10 times longer, parameter is fraction of long ones
+    bimodal
+};
+
+inline char const*
+to_string(Distributions _distribution)
+{
+    switch (_distribution) {
+    case Distributions::uniform:
+        return "uniform";
+
+    case Distributions::fixed:
+        return "fixed";
+
+    case Distributions::exponential:
+        return "exponential";
+
+    case Distributions::pareto:
+        return "pareto";
+
+    case Distributions::bimodal:
+        return "bimodal";
+
+    default:
+        return "?????";
+    }
+}
+
+inline Distributions
+distribution_from_string(std::string const& _name)
+{
+    for (auto const distribution : {Distributions::uniform, Distributions::fixed, Distributions::exponential, Distributions::pareto, Distributions::bimodal}) {
+        if (_name == to_string(distribution)) {
+            return distribution;
+        }
+    }
+
+    throw std::invalid_argument("Unknown distribution: " + _name);
+}
+
+/// @brief distribution of intervals with its parameter
+///
+/// All distributions have the mean of the uniform one, g_max_interval / 2, times the seat factor,
+/// so profiles differ only in shape. Samples are rounded to g_interval_unit and bounded by 1 unit and 1000 means.
+struct Interval_profile
+{
+    Interval_profile()
+        : m_distribution(Distributions::uniform)
+        , m_parameter(0.)
+    {}
+
+    Interval_profile(Distributions _distribution, double _parameter)
+        : m_distribution(_distribution)
+        , m_parameter(_parameter)
+    {
+        if (Distributions::pareto == _distribution && !(_parameter > 1.)) {
+            throw std::invalid_argument("Pareto shape should be greater than 1");
+        }
+
+        if (Distributions::bimodal == _distribution && !(_parameter >= 0. && _parameter <= 1.)) {
+            throw std::invalid_argument("Bimodal fraction of long intervals should be in [0, 1]");
+        }
+    }
+
+    /// @brief interval for random engine owned by the caller, so sampling needs no locking
+    template<typename Engine>
+    std::chrono::nanoseconds
+        sample(Engine& _engine, double _factor)const
+    {
+        double const max_units = double(g_max_interval / g_interval_unit) * _factor;
+
+        if (Distributions::uniform == this->m_distribution) {
+            std::uniform_int_distribution<unsigned> distribution(1, unsigned(std::max(1., max_units)));
+            return distribution(_engine) * g_interval_unit;
+        }
+
+        double const mean = max_units / 2.;
+        double units = mean;
+
+        switch (this->m_distribution) {
+        case Distributions::exponential:
+            units = std::exponential_distribution<double>(1. / mean)(_engine);
+            break;
+
+        case Distributions::pareto: {
+            // inverse transform of uniform (0, 1], scale keeps the mean
+            double const scale = mean * (this->m_parameter - 1.) / this->m_parameter;
+            units = scale / std::pow(1. - std::uniform_real_distribution<double>(0., 1.)(_engine), 1. / this->m_parameter);
+            break;
+        }
+
+        case Distributions::bimodal: {
+            double const short_units = mean / (1. + 9. * this->m_parameter);
+            units = std::bernoulli_distribution(this->m_parameter)(_engine) ? 10. * short_units : short_units;
+            break;
+        }
+
+        default:
+            break;
+        }
+
+        return std::chrono::nanoseconds::rep(std::min(std::max(1., std::round(units)), 1000. * mean)) * g_interval_unit;
+    }
+
+    Distributions m_distribution;
+    /// Pareto shape or bimodal fraction, unused by other distributions
+    double m_parameter;
+};
+
+/// @brief `<distribution>[:<parameter>]`, Pareto shape defaults to 1.5, bimodal fraction to 0.1
+inline Interval_profile
+interval_profile_from_string(std::string const& _value)
+{
+    std::string::size_type const colon = _value.find(':');
+    Distributions const distribution = distribution_from_string(_value.substr(0, colon));
+    double parameter = Distributions::pareto == distribution ? 1.5 : Distributions::bimodal == distribution ? 0.1 : 0.;
+
+    if (colon != std::string::npos) {
+        if (Distributions::pareto != distribution && Distributions::bimodal != distribution) {
+            throw std::invalid_argument("Distribution has no parameter: " + _value);
+        }
+
+        parameter = std::strtod(_value.c_str() + colon + 1, nullptr);
+    }
+
+    return Interval_profile(distribution, parameter);
+}
+
+inline std::string
+to_string(Interval_profile const& _profile)
+{
+    std::string result = to_string(_profile.m_distribution);
+
+    if (Distributions::pareto == _profile.m_distribution || Distributions::bimodal == _profile.m_distribution) {
+        result += ":" + std::to_string(_profile.m_parameter);
+        result.erase(result.find_last_not_of('0') + 1);
+
+        if ('.' == result.back()) {
+            result.pop_back();
+        }
+    }
+
+    return result;
+}
+
+/// @brief comma separated seats and ranges, e.g. `0-3,7`
+inline std::vector<unsigned>
+seats_from_string(std::string const& _value)
+{
+    std::vector<unsigned> result;
+
+    for (std::string::size_type begin = 0; begin < _value.size();) {
+        std::string::size_type const end = std::min(_value.find(',', begin), _value.size());
+        std::string const item = _value.substr(begin, end - begin);
+        std::string::size_type const dash = item.find('-');
+        char* p_end = nullptr;
+        unsigned long const first = std::strtoul(item.c_str(), &p_end, 10);
+        unsigned long const last = dash == std::string::npos ? first : std::strtoul(item.c_str() + dash + 1, nullptr, 10);
+
+        if (item.empty() || p_end == item.c_str() || last < first) {
+            throw std::invalid_argument("Invalid seats: " + _value);
+        }
+
+        for (unsigned long seat = first; seat <= last; ++seat) {
+            result.push_back(unsigned(seat));
+        }
+
+        begin = end + 1;
+    }
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+/// @brief thinking and eating profiles of all seats, hot seats eat hot factor times longer
+struct Workload
+{
+    Workload()
+        : m_hot_factor(10.)
+    {}
+
+    bool
+        is_hot(unsigned _seat)const
+    {
+        return std::binary_search(this->m_hot_seats.cbegin(), this->m_hot_seats.cend(), _seat);
+    }
+
+    /// @brief eating intervals of seat are scaled by it
+    double
+        eating_factor(unsigned _seat)const
+    {
+        return is_hot(_seat) ? this->m_hot_factor : 1.;
+    }
+
+    Interval_profile m_thinking;
+    Interval_profile m_eating;
+    /// banquet-wide seat ids in ascending order
+    std::vector<unsigned> m_hot_seats;
+    double m_hot_factor;
+};
+
+}  // namespace philosophers
+
+#endif  // PHILOSOPHERS_WORKLOAD_HPP_